@@ -8,82 +8,375 @@
 
 #define DEF_HOST "localhost"
 #define DEF_PORT 1883
-#define TOPIC       "omnistat/#"
 #define TIMEOUT     10000L
+#define MQTT_KEEPALIVE	60	// seconds
 
-static struct mosquitto *mosq;
-static GIOChannel *mosq_gio_chan;
-static int mosq_fd;
+#define MQTT_BACKOFF_MIN	1000	// milliseconds before the first reconnect attempt
+#define MQTT_BACKOFF_MAX	60000	// doubling up to this
+
+extern int g_verbose;
 
-static guint mosq_misc_timer_tag = 0;
+static struct mosquitto *mosq;
 static GSource *mosquitto_source;
 
+static char *mqtt_host;
+static int mqtt_port;
+static gboolean mqtt_connected;
+static gboolean mqtt_stopping;
+static guint mqtt_retry_tag;	// reconnect timer, 0 if none
+static int mqtt_backoff;	// current reconnect delay, milliseconds
+static gboolean mqtt_retain;	// publish state and values retained
+static char *mqtt_will_topic;
+static char *mqtt_will_payload;
+
+// MQTT v5 mode
+static gboolean mqtt_v5;
+static int mqtt_expiry = 300;	// seconds until telemetry is stale, 0 for never
+static int mqtt_alias_max;	// topic aliases the broker accepts, from CONNACK
+static int mqtt_alias_next;
+static GHashTable *mqtt_aliases;	// topic -> alias, for this connection
+
+// threaded mode: mosquitto and publishing run on their own threads, see mq_thread.c
+static gboolean mqtt_threaded;
+
+static void mqtt_try_connect();
+
+static gboolean
+mqtt_retry_dispatch(gpointer user_data)
+{
+	mqtt_retry_tag = 0;
+	mqtt_try_connect();
+	return G_SOURCE_REMOVE;
+}
+
+// arrange another connection attempt, after a jittered exponential backoff.
+// safe to call more than once for the same failure.
+static void
+mqtt_schedule_retry()
+{
+	if(mqtt_retry_tag || mqtt_stopping)
+		return;
+	mqtt_backoff = mqtt_backoff ? MIN(mqtt_backoff * 2, MQTT_BACKOFF_MAX) : MQTT_BACKOFF_MIN;
+	int delay = mqtt_backoff * g_random_double_range(0.75, 1.25);
+	printf("mqtt: reconnecting in %d ms\n", delay);
+	mqtt_retry_tag = g_timeout_add(delay, mqtt_retry_dispatch, NULL);
+}
+
+// the connection is gone; serial polling carries on regardless
+static void
+mqtt_lost()
+{
+	mqtt_connected = FALSE;
+	mqtt_schedule_retry();
+}
+
+// start a non-blocking connect.  the outcome arrives in on_connect, or as a socket error.
+static void
+mqtt_try_connect()
+{
+	int rc = mosquitto_connect_async(mosq, mqtt_host, mqtt_port, MQTT_KEEPALIVE);
+	if(rc != MOSQ_ERR_SUCCESS) {
+		fprintf(stderr, "Failed to connect to mqtt broker at %s:%d: %s\n",
+			mqtt_host, mqtt_port, mosquitto_strerror(rc));
+		mqtt_lost();
+	}
+}
+
+// [server] retain=true: state and value topics are published retained, so a new
+// subscriber gets the current picture straight from the broker.
+//
+// [server] mqtt_v5=true: speak MQTT v5.  Node topics get topic aliases, up to the number
+// the broker allows, so after the first publish only a short number is sent in place of
+// the topic string.  Telemetry carries a message expiry of mqtt_expiry seconds (default
+// 300), less any time spent in our outbox, so a stale reading is dropped rather than
+// delivered late; and a "ts" user property, the unix time it was read.
+void
+mqtt_load_config(GKeyFile *kf)
+{
+	mqtt_retain = g_key_file_get_boolean(kf, "server", "retain", NULL);
+	mqtt_v5 = g_key_file_get_boolean(kf, "server", "mqtt_v5", NULL);
+	if(g_key_file_has_key(kf, "server", "mqtt_expiry", NULL))
+		mqtt_expiry = g_key_file_get_integer(kf, "server", "mqtt_expiry", NULL);
+	mqtt_threaded = g_key_file_get_boolean(kf, "server", "mqtt_thread", NULL);
+}
+
+// MQ_PUB_RETAIN if retained mode is on, for topics that carry state
+int
+mqtt_retain_flags()
+{
+	return mqtt_retain ? MQ_PUB_RETAIN : 0;
+}
+
+// message for the broker to publish if we vanish without saying goodbye.
+// call before mqtt_setup.
+void
+mqtt_set_will(const char *topic, const char *payload)
+{
+	g_free(mqtt_will_topic);
+	g_free(mqtt_will_payload);
+	mqtt_will_topic = g_strdup(topic);
+	mqtt_will_payload = g_strdup(payload);
+}
+
+gboolean
+mqtt_is_connected()
+{
+	return mqtt_connected;
+}
+
+static void
+mqtt_subscribe_all(struct mosquitto *mosq)
+{
+	// only the command topics, not everything under omnistat/, which would include our own publishes
+	for(char **sub = mq_dispatch_subscriptions(); *sub; sub++)
+		mosquitto_subscribe(mosq, NULL, *sub, 1);
+}
+
+// a new connection is up and subscribed
+static void
+mqtt_connected_init()
+{
+	printf("Connected to mqtt broker\n");
+	mqtt_connected = TRUE;
+	mqtt_backoff = 0;
+	publish_hello();
+	oms_list_broker_connected();
+	mq_outbox_drain();
+}
+
+// threaded mode, on the mosquitto thread: subscribing is safe here, the rest is
+// for the main loop.  mosquitto reconnects by itself after a failure.
+static void
+mqtt_thread_connect(struct mosquitto *mosq, int rc, int alias_max)
+{
+	if(rc == 0)
+		mqtt_subscribe_all(mosq);
+	mq_thread_post_connect(rc, alias_max);
+}
+
+// threaded mode, on the main loop
+void
+mqtt_connected_main(int rc, int alias_max)
+{
+	if(rc != 0) {
+		fprintf(stderr, "Failed to connect, return code %d\n", rc);
+		return;
+	}
+	// ahead of anything published on the new connection
+	mq_thread_reset_aliases(alias_max);
+	mqtt_connected_init();
+}
+
+void
+mqtt_disconnected_main()
+{
+	printf("Disconnected from mqtt broker\n");
+	mqtt_connected = FALSE;
+	mq_thread_reset_aliases(0);
+}
+
 void on_connect(struct mosquitto *mosq, void *obj, int rc)
 {
+    if(mqtt_threaded) {
+	mqtt_thread_connect(mosq, rc, 0);
+	return;
+    }
     if (rc == 0) {
-        printf("Connected to mqtt broker\n");
-        mosquitto_subscribe(mosq, NULL, TOPIC, 1);
-	// TODO hook to subscribe to more
+	mqtt_subscribe_all(mosq);
+	mqtt_connected_init();
     } else {
         fprintf(stderr, "Failed to connect, return code %d\n", rc);
+	mosquitto_disconnect(mosq);
+	mqtt_lost();
     }
 }
 
 void on_message(struct mosquitto *mosq, void *obj, const struct mosquitto_message *msg)
 {
 //	printf("Received message: %s on topic %s\n", (char *)msg->payload, msg->topic);
-	mq_recv_message( msg->topic, (char *)msg->payload );
+	if(mqtt_threaded)
+		mq_thread_post_message(msg->topic, msg->payload, msg->payloadlen, NULL);
+	else
+		mq_recv_message(msg->topic, msg->payload, msg->payloadlen, NULL);
+}
+
+void on_connect_v5(struct mosquitto *mosq, void *obj, int rc, int flags, const mosquitto_property *props)
+{
+	uint16_t amax = 0;
+	mosquitto_property_read_int16(props, MQTT_PROP_TOPIC_ALIAS_MAXIMUM, &amax, false);
+	if(mqtt_threaded) {
+		mqtt_thread_connect(mosq, rc, amax);
+		return;
+	}
+	mqtt_alias_reset(amax);
+	on_connect(mosq, obj, rc);
+}
+
+// aliases only last as long as the connection.  called on whichever thread publishes.
+void
+mqtt_alias_reset(int alias_max)
+{
+	mqtt_alias_max = alias_max;
+	mqtt_alias_next = 0;
+	if(mqtt_aliases)
+		g_hash_table_remove_all(mqtt_aliases);
+	else
+		mqtt_aliases = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
+
+// commands may name a response topic and correlation data for their result
+void on_message_v5(struct mosquitto *mosq, void *obj, const struct mosquitto_message *msg,
+		   const mosquitto_property *props)
+{
+	MqReplyTo rt = { NULL, NULL, 0 };
+	uint16_t clen = 0;
+
+	mosquitto_property_read_string(props, MQTT_PROP_RESPONSE_TOPIC, &rt.topic, false);
+	mosquitto_property_read_binary(props, MQTT_PROP_CORRELATION_DATA, &rt.corr, &clen, false);
+	rt.corrlen = clen;
+	if(mqtt_threaded)
+		mq_thread_post_message(msg->topic, msg->payload, msg->payloadlen, rt.topic ? &rt : NULL);
+	else
+		mq_recv_message(msg->topic, msg->payload, msg->payloadlen, rt.topic ? &rt : NULL);
+	free(rt.topic);
+	free(rt.corr);
 }
 
 void on_disconnect(struct mosquitto *mosq, void *obj, int rc)
 {
+	if(mqtt_threaded) {
+		mq_thread_post_disconnect();
+		return;
+	}
 	printf("Disconnected from mqtt broker\n");
+	mqtt_lost();
 }
 
 
 
+/*
+ * GSource for the mosquitto client.  Watches the socket for reading always,
+ * and for writing only while mosquitto has something queued; picks up a
+ * new socket after a reconnect; and wakes up for mosquitto_loop_misc only
+ * when a keepalive ping could be due, rather than on a fixed timer.
+ */
+typedef struct {
+	GSource source;
+	struct mosquitto *mosq;
+	int fd;			// socket being watched, or -1
+	gpointer fd_tag;
+	gint64 last_in;		// monotonic time of last read from the broker
+	gint64 last_out;	// ... and of last write to it
+	gint64 last_misc;	// last mosquitto_loop_misc call
+} MosqSource;
+
+// time by which loop_misc must run to get a ping out within the keepalive.
+// while a ping is unanswered, look again once a second so a dead broker is noticed.
+static gint64
+mosq_source_deadline(MosqSource *ms)
+{
+	gint64 due = MIN(ms->last_in, ms->last_out) + MQTT_KEEPALIVE * G_USEC_PER_SEC;
+	return MAX(due, ms->last_misc + G_USEC_PER_SEC);
+}
+
 static gboolean
-mosquitto_fd_dispatch(GIOChannel* source,
-		      GIOCondition condition,
-		      gpointer user_data)
+mosq_source_prepare(GSource *source, gint *timeout)
 {
-	struct mosquitto *mosq = user_data;
-	int new_mosq_fd;
+	MosqSource *ms = (MosqSource *)source;
+	// a dead socket may linger until the retry; don't spin on it meanwhile
+	int fd = mqtt_retry_tag ? -1 : mosquitto_socket(ms->mosq);
+	GIOCondition cond = G_IO_IN | G_IO_HUP | G_IO_ERR;
 
-	int ret = mosquitto_loop_read(mosq, 1);
-	if (ret == MOSQ_ERR_CONN_LOST) {
-		/* We've been disconnected from the server */
-		printf("Reconnect...\n");
-		mosquitto_reconnect(mosq);
-	}
-	if (mosquitto_want_write(mosq)) {
-		mosquitto_loop_write(mosq, 8);
+	if(fd != ms->fd) {
+		if(g_verbose)
+			printf("mosq_fd was %d now %d\n", ms->fd, fd);
+		if(ms->fd_tag)
+			g_source_remove_unix_fd(source, ms->fd_tag);
+		ms->fd_tag = NULL;
+		ms->fd = fd;
+		if(fd >= 0)
+			ms->fd_tag = g_source_add_unix_fd(source, fd, cond);
+		ms->last_in = ms->last_out = g_get_monotonic_time();
 	}
-	mosquitto_loop_misc(mosq);
-	new_mosq_fd = mosquitto_socket(mosq);
-	if(new_mosq_fd != mosq_fd) {
-		printf("mosq_fd was %d now %d\n", mosq_fd, new_mosq_fd);
+	if(ms->fd_tag) {
+		if(mosquitto_want_write(ms->mosq))
+			cond |= G_IO_OUT;
+		g_source_modify_unix_fd(source, ms->fd_tag, cond);
 	}
+	// nothing for loop_misc to do without a connection
+	g_source_set_ready_time(source, ms->fd_tag ? mosq_source_deadline(ms) : -1);
+	*timeout = -1;
+	return FALSE;
 }
 
 static gboolean
-mosquitto_misc_dispatch(gpointer user_data)
+mosq_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	MosqSource *ms = (MosqSource *)source;
+	GIOCondition cond = ms->fd_tag ? g_source_query_unix_fd(source, ms->fd_tag) : 0;
+	gint64 now = g_get_monotonic_time();
+
+	if(cond & (G_IO_IN | G_IO_HUP | G_IO_ERR)) {
+		int ret = mosquitto_loop_read(ms->mosq, 1);
+		ms->last_in = now;
+		if (ret != MOSQ_ERR_SUCCESS) {
+			/* We've been disconnected from the server; don't wait for it here */
+			mqtt_lost();
+			return G_SOURCE_CONTINUE;	// prepare will notice the socket is gone
+		}
+	}
+	if((cond & G_IO_OUT) && mosquitto_want_write(ms->mosq)) {
+		// also how a non-blocking connect completes
+		if(mosquitto_loop_write(ms->mosq, 8) != MOSQ_ERR_SUCCESS) {
+			mqtt_lost();
+			return G_SOURCE_CONTINUE;
+		}
+		ms->last_out = now;
+	}
+	if(now >= mosq_source_deadline(ms)) {
+		mosquitto_loop_misc(ms->mosq);	// sends PINGREQ, or notices a missing PINGRESP
+		ms->last_misc = now;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs mosq_source_funcs = {
+	mosq_source_prepare,
+	NULL,
+	mosq_source_dispatch,
+	NULL,
+};
+
+static GSource *
+mosq_source_new(struct mosquitto *mosq)
+{
+	MosqSource *ms = (MosqSource *)g_source_new(&mosq_source_funcs, sizeof(MosqSource));
+	ms->mosq = mosq;
+	ms->fd = -1;
+	ms->fd_tag = NULL;
+	g_source_set_name(&ms->source, "mosquitto");
+	return &ms->source;
+}
+
+// note traffic we sent outside the source's own dispatch
+static void
+mosq_note_out()
 {
-	struct mosquitto *mosq = user_data;
-//	printf("mosq_misc_timeout\n");
-	mosquitto_loop_misc(mosq);
-	return TRUE;
+	if(mosquitto_source)
+		((MosqSource *)mosquitto_source)->last_out = g_get_monotonic_time();
 }
 
-// Initialize the MQTT client
+// Initialize the MQTT client.  Connecting happens in the background,
+// and is retried for as long as it takes; serial polling doesn't wait for it.
 int
 mqtt_setup( GMainLoop *loop, char *host, int port)
 {
-	int rc;
 	if(host == NULL)
 		host = DEF_HOST;
 	if(port < 0)
 		port = DEF_PORT;
+	mqtt_host = g_strdup(host);
+	mqtt_port = port;
 
 	// Initialize the Mosquitto library
 	mosquitto_lib_init();
@@ -96,43 +389,212 @@ mqtt_setup( GMainLoop *loop, char *host, int port)
 	}
 	
 	// Set callbacks
-	mosquitto_connect_callback_set(mosq, on_connect);
-	mosquitto_message_callback_set(mosq, on_message);
+	if(mqtt_v5) {
+		mosquitto_int_option(mosq, MOSQ_OPT_PROTOCOL_VERSION, MQTT_PROTOCOL_V5);
+		mosquitto_connect_v5_callback_set(mosq, on_connect_v5);
+		mosquitto_message_v5_callback_set(mosq, on_message_v5);
+	} else {
+		mosquitto_connect_callback_set(mosq, on_connect);
+		mosquitto_message_callback_set(mosq, on_message);
+	}
 	mosquitto_disconnect_callback_set(mosq, on_disconnect);
-	printf("got mosq client fd=%d; trying to connect:\n", mosquitto_socket(mosq));
-	
-	// Connect to the MQTT broker
-	if (mosquitto_connect(mosq, host, port, 60) != MOSQ_ERR_SUCCESS) {
-		fprintf(stderr, "Failed to connect to mqtt broker at %s:%d\n", host, port);
+	if(mqtt_will_topic)
+		mosquitto_will_set(mosq, mqtt_will_topic, strlen(mqtt_will_payload), mqtt_will_payload,
+				   1, mqtt_retain);
+
+	printf("connecting to mqtt broker at %s:%d\n", host, port);
+	if(mqtt_threaded) {
+		// mosquitto's own thread does the connecting, and the reconnecting with backoff
+		if(mq_thread_start() < 0)
+			return 1;
+		mosquitto_reconnect_delay_set(mosq, MQTT_BACKOFF_MIN / 1000, MQTT_BACKOFF_MAX / 1000, true);
+		int rc = mosquitto_connect_async(mosq, mqtt_host, mqtt_port, MQTT_KEEPALIVE);
+		if(rc != MOSQ_ERR_SUCCESS)
+			fprintf(stderr, "Failed to connect to mqtt broker at %s:%d: %s; will retry\n",
+				mqtt_host, mqtt_port, mosquitto_strerror(rc));
+		rc = mosquitto_loop_start(mosq);
+		if(rc != MOSQ_ERR_SUCCESS)
+			fprintf(stderr, "mqtt: can't start network thread: %s\n", mosquitto_strerror(rc));
 		return 1;
 	}
 
-	// Add Mosquitto to GMainLoop
-	mosq_fd = mosquitto_socket(mosq);
-	printf("connected; adding moscq_fd=%d to gio\n", mosq_fd);
-	mosq_gio_chan = g_io_channel_unix_new(mosq_fd);
-	g_io_add_watch(mosq_gio_chan, G_IO_IN | G_IO_HUP | G_IO_ERR,
-		       mosquitto_fd_dispatch, 
-		       (gpointer)mosq);
+	// Add Mosquitto to GMainLoop; the source follows the socket as it comes and goes
+	mosquitto_source = mosq_source_new(mosq);
+	g_source_attach(mosquitto_source, g_main_loop_get_context(loop));
 
-	// set up periodic timer that will call mosquitto_loop_misc
-	mosq_misc_timer_tag = g_timeout_add(500, mosquitto_misc_dispatch, mosq);
+	mqtt_try_connect();
 	return 1;
 }
 
+// on the way out, after the main loop has stopped: send what's still queued (the
+// goodbye states, usually), disconnect, and wait for it to go.
 void
 mqtt_shutdown()
 {
-	if(mosq_misc_timer_tag != 0)
-		g_source_remove(mosq_misc_timer_tag);
-	mosq_misc_timer_tag = 0;
+	if(!mosq)
+		return;
+	mqtt_stopping = TRUE;
+	if(mqtt_retry_tag)
+		g_source_remove(mqtt_retry_tag);
+	mqtt_retry_tag = 0;
+	mq_outbox_flush();
+	if(mqtt_threaded)
+		mq_thread_stop();	// the publisher works through its queue first
 	mosquitto_disconnect(mosq);
+	if(mqtt_threaded)
+		mosquitto_loop_stop(mosq, false);
+	else {
+		// the mosquitto source doesn't run any more; write out what it would have
+		for(int i = 0; i < 20 && mosquitto_want_write(mosq); i++)
+			mosquitto_loop(mosq, 100, 1);
+	}
+	if(mosquitto_source) {
+		g_source_destroy(mosquitto_source);
+		g_source_unref(mosquitto_source);
+		mosquitto_source = NULL;
+	}
 	mosquitto_destroy(mosq);
 	mosquitto_lib_cleanup();
 }
 
+static int
+mqtt_send_v5(const char *topic, const void *payload, int len, int flags, time_t ts)
+{
+	mosquitto_property *props = NULL;
+	const char *ptopic = topic;
+	int alias = 0;
+	int newalias = 0;
+	int rc;
+
+	if(flags & MQ_PUB_TELEMETRY) {
+		char tsbuf[24];
+		if(mqtt_expiry) {
+			int left = mqtt_expiry - (time(NULL) - ts);
+			if(left <= 0)
+				return MOSQ_ERR_SUCCESS;	// too old to be worth sending
+			mosquitto_property_add_int32(&props, MQTT_PROP_MESSAGE_EXPIRY_INTERVAL, left);
+		}
+		snprintf(tsbuf, sizeof(tsbuf), "%ld", (long)ts);
+		mosquitto_property_add_string_pair(&props, MQTT_PROP_USER_PROPERTY, "ts", tsbuf);
+	}
+	if((flags & MQ_PUB_ALIAS) && mqtt_alias_max) {
+		alias = GPOINTER_TO_INT(g_hash_table_lookup(mqtt_aliases, topic));
+		if(alias)
+			ptopic = "";	// the broker knows it by number now
+		else if(mqtt_alias_next < mqtt_alias_max) {
+			alias = ++mqtt_alias_next;
+			newalias = 1;	// this publish teaches it to the broker
+		}
+		if(alias)
+			mosquitto_property_add_int16(&props, MQTT_PROP_TOPIC_ALIAS, alias);
+	}
+	rc = mosquitto_publish_v5(mosq, NULL, ptopic, len, payload, 0, (flags & MQ_PUB_RETAIN) != 0, props);
+	mosquitto_property_free_all(&props);
+	if(newalias && rc == MOSQ_ERR_SUCCESS)
+		g_hash_table_insert(mqtt_aliases, g_strdup(topic), GINT_TO_POINTER(alias));
+	return rc;
+}
+
+// hand one message to mosquitto now, on whichever thread publishes.
+// returns 0, or the mosquitto error.
+int
+mqtt_send_now(const char *topic, const void *payload, int len, int flags, time_t ts)
+{
+	int rc;
+	if(mqtt_v5)
+		rc = mqtt_send_v5(topic, payload, len, flags, ts);
+	else
+		rc = mosquitto_publish(mosq, NULL, topic, len, payload, 0, (flags & MQ_PUB_RETAIN) != 0);
+	if(rc == MOSQ_ERR_SUCCESS)
+		mosq_note_out();
+	return rc;
+}
+
+// send one message, or queue it for the publisher thread.  ts is when its value was read.
+// returns 0, or the mosquitto error.
+int
+mqtt_send(const char *topic, const void *payload, int len, int flags, time_t ts)
+{
+	if(!mqtt_connected)
+		return MOSQ_ERR_NO_CONN;
+	if(mqtt_threaded) {
+		mq_thread_publish(topic, payload, len, flags, ts);
+		return MOSQ_ERR_SUCCESS;
+	}
+	return mqtt_send_now(topic, payload, len, flags, ts);
+}
+
+// a send failed with rc: TRUE if only for want of a connection, so it's worth
+// keeping for later.  anything else (a bad topic, a packet too big) would fail
+// the same way every time, so note it, now and then, and let the message go.
+// called from the publisher thread as well.
+gboolean
+mqtt_send_retry(const char *topic, int rc)
+{
+	static guint dropped;
+	guint n;
+
+	if(rc == MOSQ_ERR_NO_CONN || rc == MOSQ_ERR_CONN_LOST)
+		return TRUE;
+	n = __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+	if(n % 100 == 0)
+		fprintf(stderr, "mqtt: can't publish on %s: %s; %u dropped so far\n",
+			topic, mosquitto_strerror(rc), n + 1);
+	return FALSE;
+}
+
+// answer a v5 command on the response topic it named, with its correlation data.
+// not kept in the outbox: the asker won't be waiting for it after an outage.
+void
+mqtt_publish_reply(const MqReplyTo *rt, const char *payload, int len)
+{
+	if(!mqtt_connected || !rt || !rt->topic)
+		return;
+	if(mqtt_threaded)
+		mq_thread_reply(rt, payload, len);
+	else
+		mqtt_publish_reply_now(rt, payload, len);
+}
+
+void
+mqtt_publish_reply_now(const MqReplyTo *rt, const char *payload, int len)
+{
+	mosquitto_property *props = NULL;
+	if(rt->corr)
+		mosquitto_property_add_binary(&props, MQTT_PROP_CORRELATION_DATA, rt->corr, rt->corrlen);
+	mosquitto_publish_v5(mosq, NULL, rt->topic, len, payload, 0, false, props);
+	mosquitto_property_free_all(&props);
+	mosq_note_out();
+}
+
+// send now if we can, otherwise keep it in the outbox.  a topic that already has
+// something in the outbox queues behind it, so values for one topic stay in order.
+static void
+mqtt_publish_n(const char *topic, const void *payload, int len, int flags)
+{
+	time_t now = time(NULL);
+	int rc = MOSQ_ERR_NO_CONN;
+
+	if(!mq_outbox_holds(topic))
+		rc = mqtt_send(topic, payload, len, flags, now);
+	if(rc == MOSQ_ERR_SUCCESS || !mqtt_send_retry(topic, rc))
+		return;
+	mq_outbox_put(topic, payload, len, flags, now);
+	if(mqtt_connected)
+		mq_outbox_drain();
+}
+
+// server topics; all of them are state
 void
 mqtt_publish(char *topic, char *msg)
 {
-	mosquitto_publish(mosq, NULL, topic, strlen(msg), msg, 0, 0);
+	mqtt_publish_n(topic, msg, strlen(msg), MQ_PUB_PRIO | mqtt_retain_flags());
+}
+
+// publish len bytes on a prebuilt topic
+void
+mqtt_publish_topic(const OmsTopic *t, const char *msg, int len)
+{
+	if(t->s)
+		mqtt_publish_n(t->s, msg, len, t->flags);
 }
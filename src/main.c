@@ -21,6 +21,7 @@ int g_mqtt_port = -1;
 
 void publish_hello();
 void publish_goodbye();
+void set_server_will();
 
 OmsChan *g_omc = NULL;   // just one for now.  todo: more serial channels
 
@@ -54,6 +55,7 @@ poll_loop(OmsChan *omc)
         GMainLoop *mainloop;
         mainloop = g_main_loop_new(NULL, TRUE);
 
+	set_server_will();
 	mqtt_setup(mainloop, g_mqtt_host, g_mqtt_port);
 	
 	// Add signal handlers for graceful shutdown
@@ -69,10 +71,13 @@ poll_loop(OmsChan *omc)
 
 	if(g_verbose)
 		printf("starting main loop");
-	publish_hello();
+	// publish_hello() is called once connected to the broker
         g_main_loop_run(mainloop);
 
+	oms_warm_save(TRUE);	// before goodbye marks every node dead
 	publish_goodbye();
+	mqtt_shutdown();	// sees the goodbye out before we exit
+	oms_store_close();
 }
 
 GKeyFile *g_cfg_file;
@@ -117,6 +122,24 @@ read_config_file(char *fname)
 		g_mqtt_port = atoi(mport_str);
 	else
 		g_mqtt_port = -1;
+
+	oms_pub_policy_load(g_cfg_file);
+	oms_doc_load_config(g_cfg_file);
+	oms_bin_load_config(g_cfg_file);
+	mq_outbox_load_config(g_cfg_file);
+	mqtt_load_config(g_cfg_file);
+	oms_group_load_config(g_cfg_file);
+	oms_poll_load_config(g_cfg_file);
+	oms_runtime_load_config(g_cfg_file);
+	oms_hist_load_config(g_cfg_file);
+	oms_store_load_config(g_cfg_file);
+	oms_warm_load_config(g_cfg_file);
+
+	char *tfmt = g_key_file_get_string (g_cfg_file, "server", "topic_format", NULL);
+	if(tfmt) {
+		oms_topic_set_format(tfmt);
+		g_free(tfmt);
+	}
 }
 
 int
@@ -131,7 +154,7 @@ nodes_from_config_file()
 	int enabled;
 	for(i = 0; i < ngroups; i++) {
 //		printf("group: %s:\n", groups[i]);
-		if(strcmp(groups[i], "server")) {
+		if(strcmp(groups[i], "server") && strcmp(groups[i], "publish") && strcmp(groups[i], "groups")) {
 			addr = -1;
 			name = NULL;
 			enabled = 0;
@@ -159,7 +182,11 @@ nodes_from_config_file()
 
 //			printf("  name=%s addr=%d enab=%d\n", name, addr, enabled);
 			if(enabled && name && addr > 0) {
-				oms_chan_add_node(g_omc, addr, name);
+				const char *why = oms_node_name_check(name);
+				if(why)
+					fprintf(stderr, "[%s]: node %s not added: %s\n", groups[i], name, why);
+				else
+					oms_chan_add_node(g_omc, addr, name);
 				g_free(name);
 			}
 		}
@@ -168,6 +195,16 @@ nodes_from_config_file()
 }
 
 
+// the broker publishes our server state as dead if we disappear,
+// covering a crash and not just a clean shutdown
+void
+set_server_will()
+{
+	char topic[128];
+	sprintf(topic, "omnistat/server/%s/state", g_devname_noslash);
+	mqtt_set_will(topic, "dead");
+}
+
 void
 publish_hello()
 {
@@ -277,10 +314,19 @@ main(int argc, char **argv)
 			fprintf(stderr, "either specify -c config-file or -n nodename -a address\n");
 			exit(1);
 		}
+		const char *why = oms_node_name_check(opt_n);
+		if(why) {
+			fprintf(stderr, "-n %s: %s\n", opt_n, why);
+			exit(1);
+		}
 		oms_chan_add_node(g_omc, opt_a, opt_n);
 	}
 	
+	oms_warm_restore();
 	per_minute_init();
+	oms_poll_init();
+	oms_runtime_init();
+	oms_warm_init();
 	
         setlinebuf(stdout);
         setlinebuf(stderr);
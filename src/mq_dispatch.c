@@ -0,0 +1,369 @@
+/*
+ * routing of incoming mqtt command messages.
+ *
+ * Topics are matched one '/'-separated level at a time against a trie built
+ * ahead of time: omnistat -> node name -> command, with the rest of the topic
+ * passed to the command handler as its argument.  Node names aren't in the
+ * trie; that level is looked up in the node name index, and any name found
+ * there continues on the shared node command list.  Group names under
+ * omnistat/group/ work the same way, with the group command list.  The
+ * broker's topic and payload buffers are never written to.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <utils.h>
+
+#define MQ_PAYLOAD_MAX	4096	// larger command payloads are dropped
+
+extern OmsChan *g_omc;
+
+// handler for one command.  arg is the remainder of the topic after the command, NUL-terminated
+// (empty if none).  payload is exactly as received, with its length.
+typedef void (*MqCmdHandler)(OmsNode *nd, char *arg, const char *payload, int len);
+
+typedef struct _MqTrie MqTrie;
+struct _MqTrie {
+	char *seg;		// topic level to match
+	int seglen;
+	MqTrie *child;		// first entry on the next level
+	MqTrie *next;		// next entry on this level
+	MqCmdHandler fn;	// command entries
+};
+
+struct mq_cmd {
+	char *name;
+	char *sub;		// subscription pattern below omnistat/+/ or omnistat/server/
+	MqCmdHandler fn;
+};
+
+// copy a short payload into buf as a string; returns FALSE if it doesn't fit
+static gboolean
+mq_payload_str(char *buf, const char *payload, int len)
+{
+	if(len >= MQSTRSIZE)
+		return FALSE;
+	memcpy(buf, payload, len);
+	buf[len] = 0;
+	return TRUE;
+}
+
+// set/<register>[/<correlation id>]
+static void
+mq_cmd_set(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	char val[MQSTRSIZE];
+	char *id = strchr(arg, '/');
+	if(strpbrk(arg, "\"\\"))
+		return;		// we echo these back in JSON
+	if(id)
+		*id++ = 0;
+	if(*arg && mq_payload_str(val, payload, len)) {
+		oms_nd_set_reg_req(nd, arg, val, id, mq_dispatch_reply_to());
+		oms_nd_boost(nd, 0);
+	}
+}
+
+static const OmsGroup *mq_cur_group;	// group named in the topic being handled
+
+// group/<group>/set/<register>[/<correlation id>]
+static void
+mq_grp_set(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	char val[MQSTRSIZE];
+	char *id = strchr(arg, '/');
+	if(strpbrk(arg, "\"\\"))
+		return;
+	if(id)
+		*id++ = 0;
+	if(*arg && mq_payload_str(val, payload, len))
+		oms_group_set((OmsGroup *)mq_cur_group, arg, val, id, mq_dispatch_reply_to());
+}
+
+static void
+mq_cmd_getreg(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	if(*arg) {
+		oms_nd_get_reg_str(nd, arg);
+		oms_nd_boost(nd, 0);
+	}
+}
+
+static void
+mq_cmd_history(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	oms_nd_history_query(nd, payload, len, mq_dispatch_reply_to());
+}
+
+// payload, if any, is how many seconds to watch for
+static void
+mq_cmd_watch(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	char val[MQSTRSIZE];
+	int secs = 0;
+	if(len && mq_payload_str(val, payload, len))
+		secs = atoi(val);
+	oms_nd_boost(nd, secs);
+}
+
+static void
+mq_cmd_snapshot(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	if(strcmp(arg, "get") == 0)
+		oms_nd_snapshot(nd);
+}
+
+static void
+mq_cmd_config(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	oms_nd_set_config(nd, payload, len);
+}
+
+static void
+mq_cmd_setmany(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	oms_nd_setmany(nd, payload, len);
+}
+
+static void
+mq_cmd_getmany(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	oms_nd_getmany(nd, payload, len);
+}
+
+static void
+mq_cmd_txn(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	oms_nd_txn_str(nd, payload, len);
+}
+
+static void
+mq_srv_dump(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	for(int c = 0; oms_chans && c < oms_chans->len; c++)
+		oms_chan_dump_nodes(g_ptr_array_index(oms_chans, c));
+}
+
+struct mq_node_args {
+	int addr;
+	char name[MQSTRSIZE];
+};
+
+static void
+mq_node_kv(char *key, char *val, void *data)
+{
+	struct mq_node_args *a = data;
+	if(strcmp(key, "address") == 0 || strcmp(key, "addr") == 0)
+		a->addr = strtol(val, NULL, 0);
+	else if(strcmp(key, "name") == 0)
+		g_strlcpy(a->name, val, MQSTRSIZE);
+}
+
+// payload address=<n>;name=<name>, same keys as a node section in the config file.
+// new nodes go on the first channel, and are picked up by the next per-minute poll.
+static void
+mq_srv_addnode(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	struct mq_node_args a = { 0 };
+	const char *why;
+	if(kv_parse(payload, len, mq_node_kv, &a) < 0 || !a.name[0] || !g_omc) {
+		fprintf(stderr, "addnode: need address and name\n");
+		return;
+	}
+	if((why = oms_node_name_check(a.name))) {
+		fprintf(stderr, "addnode: %s: %s\n", a.name, why);
+		return;
+	}
+	oms_chan_add_node(g_omc, a.addr, a.name);
+}
+
+// payload is the node name
+static void
+mq_srv_delnode(OmsNode *nd, char *arg, const char *payload, int len)
+{
+	if(!(nd = oms_node_lookup(payload, len))) {
+		fprintf(stderr, "delnode: no node %.*s\n", len, payload);
+		return;
+	}
+	oms_chan_remove_node(nd->omc, nd);
+}
+
+// omnistat/<node>/...
+static struct mq_cmd node_cmds[] = {
+	{ "set",	"set/#",	mq_cmd_set },
+	{ "getreg",	"getreg/#",	mq_cmd_getreg },
+	{ "snapshot",	"snapshot/get",	mq_cmd_snapshot },
+	{ "config",	"config",	mq_cmd_config },
+	{ "txn",	"txn",		mq_cmd_txn },
+	{ "setmany",	"setmany",	mq_cmd_setmany },
+	{ "getmany",	"getmany",	mq_cmd_getmany },
+	{ "watch",	"watch",	mq_cmd_watch },
+	{ "history",	"history",	mq_cmd_history },
+};
+
+// omnistat/server/cmd/...
+static struct mq_cmd server_cmds[] = {
+	{ "dump",	"cmd/dump",	mq_srv_dump },
+	{ "addnode",	"cmd/addnode",	mq_srv_addnode },
+	{ "delnode",	"cmd/delnode",	mq_srv_delnode },
+};
+
+// omnistat/group/<group>/...
+static struct mq_cmd group_cmds[] = {
+	{ "set",	"set/#",	mq_grp_set },
+};
+
+static MqTrie *mq_root;		// "omnistat"
+static MqTrie *mq_any_group;	// likewise for group names, under "group"
+static const MqReplyTo *mq_cur_reply;	// v5 response topic of the message being handled
+static MqTrie *mq_any_node;	// stands in for whichever node name matched
+static char **mq_subs;
+
+static MqTrie *
+mq_trie_new(char *seg, MqTrie *next)
+{
+	MqTrie *t = g_new0(MqTrie, 1);
+	t->seg = g_strdup(seg);
+	t->seglen = strlen(seg);
+	t->next = next;
+	return t;
+}
+
+static MqTrie *
+mq_trie_cmds(struct mq_cmd *cmds, int n)
+{
+	MqTrie *list = NULL;
+	for(int i = n-1; i >= 0; i--) {
+		list = mq_trie_new(cmds[i].name, list);
+		list->fn = cmds[i].fn;
+	}
+	return list;
+}
+
+static void
+mq_trie_init()
+{
+	if(mq_root)
+		return;
+	mq_root = mq_trie_new("omnistat", NULL);
+	mq_any_node = mq_trie_new("+", NULL);
+	mq_any_node->child = mq_trie_cmds(node_cmds, G_N_ELEMENTS(node_cmds));
+	MqTrie *srv = mq_trie_new("server", NULL);
+	srv->child = mq_trie_new("cmd", NULL);
+	srv->child->child = mq_trie_cmds(server_cmds, G_N_ELEMENTS(server_cmds));
+	MqTrie *grp = mq_trie_new("group", srv);
+	mq_any_group = mq_trie_new("+", NULL);
+	mq_any_group->child = mq_trie_cmds(group_cmds, G_N_ELEMENTS(group_cmds));
+	grp->child = mq_any_group;
+	mq_root->child = grp;
+}
+
+// find the entry on one trie level matching seg[0..len-1]
+static MqTrie *
+mq_trie_match(MqTrie *list, const char *seg, int len)
+{
+	for(; list; list = list->next) {
+		if(list->seglen == len && memcmp(list->seg, seg, len) == 0)
+			return list;
+	}
+	return NULL;
+}
+
+// topics to subscribe to: just the commands, so we don't get our own publishes back.
+// NULL-terminated.
+char **
+mq_dispatch_subscriptions()
+{
+	if(!mq_subs) {
+		int n = 0;
+		mq_subs = g_new0(char *, G_N_ELEMENTS(node_cmds) + G_N_ELEMENTS(server_cmds)
+				 + G_N_ELEMENTS(group_cmds) + 1);
+		for(int i = 0; i < G_N_ELEMENTS(node_cmds); i++)
+			mq_subs[n++] = g_strdup_printf("omnistat/+/%s", node_cmds[i].sub);
+		for(int i = 0; i < G_N_ELEMENTS(server_cmds); i++)
+			mq_subs[n++] = g_strdup_printf("omnistat/server/%s", server_cmds[i].sub);
+		for(int i = 0; i < G_N_ELEMENTS(group_cmds); i++)
+			mq_subs[n++] = g_strdup_printf("omnistat/group/+/%s", group_cmds[i].sub);
+	}
+	return mq_subs;
+}
+
+// a copy of the current command's v5 response topic and correlation data, for a
+// handler that answers later; NULL if it didn't give one.  free with mq_reply_to_free.
+MqReplyTo *
+mq_dispatch_reply_to()
+{
+	if(!mq_cur_reply)
+		return NULL;
+	MqReplyTo *rt = g_new0(MqReplyTo, 1);
+	rt->topic = g_strdup(mq_cur_reply->topic);
+	if(mq_cur_reply->corr) {
+		rt->corr = g_malloc(mq_cur_reply->corrlen);
+		memcpy(rt->corr, mq_cur_reply->corr, mq_cur_reply->corrlen);
+		rt->corrlen = mq_cur_reply->corrlen;
+	}
+	return rt;
+}
+
+void
+mq_reply_to_free(MqReplyTo *rt)
+{
+	if(!rt)
+		return;
+	g_free(rt->topic);
+	g_free(rt->corr);
+	g_free(rt);
+}
+
+// route one message.  topic is NUL-terminated; payload is len bytes, not necessarily terminated.
+// rt is the v5 response topic and correlation data, if any.
+void
+mq_recv_message(const char *topic, const void *payload, int len, const MqReplyTo *rt)
+{
+	MqTrie *level;
+	MqTrie *t;
+	OmsNode *nd = NULL;
+	OmsGroup *grp = NULL;
+	const char *cp = topic;
+	char arg[MQSTRSIZE];
+
+	mq_trie_init();
+	if(len < 0 || len > MQ_PAYLOAD_MAX) {
+		fprintf(stderr, "mqtt message on %s: payload length %d too large\n", topic, len);
+		return;
+	}
+	for(level = mq_root; ; level = t->child) {
+		const char *ep = strchr(cp, '/');
+		int seglen = ep ? ep - cp : strlen(cp);
+		if(!(t = mq_trie_match(level, cp, seglen))) {
+			if(level == mq_root->child && (nd = oms_node_lookup(cp, seglen)))
+				t = mq_any_node;
+			else if(level == mq_any_group && (grp = oms_group_lookup(cp, seglen)))
+				t = mq_any_group;
+			else
+				return;
+		}
+		cp += seglen;
+		if(t->fn)
+			break;
+		if(!ep || !t->child)
+			return;
+		cp++;
+	}
+	if(*cp == '/')
+		cp++;
+	if(strlen(cp) >= MQSTRSIZE)
+		return;
+	strcpy(arg, cp);
+
+	printf("recieved mqtt message: %s node=%s cmd=%s arg=%s len=%d\n",
+	       topic, nd ? nd->name : "-", t->seg, arg, len);
+	mq_cur_reply = rt;
+	mq_cur_group = grp;
+	t->fn(nd, arg, (const char *)payload, len);
+	mq_cur_reply = NULL;
+	mq_cur_group = NULL;
+}
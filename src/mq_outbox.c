@@ -0,0 +1,195 @@
+/*
+ * outbox for publishes made while the broker is unreachable.
+ *
+ * Holds at most one message per topic: a newer value replaces the queued
+ * one in place.  Messages flagged MQ_PUB_EVERY (command results, binary
+ * register frames) are the exception; each is queued in its own right, in
+ * order.  Total size is capped (outbox_max bytes in [server],
+ * default 256k); when full, the oldest ordinary message is dropped first,
+ * and priority ones (thermostat and server state) only when nothing else
+ * is left.  Once connected the outbox is drained, priority messages first,
+ * at outbox_rate messages per second (default 200) so a long outage
+ * doesn't end in a flood.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+
+#define OUTBOX_MAX_DEFAULT	(256*1024)
+#define OUTBOX_RATE_DEFAULT	200
+#define OUTBOX_TICK		50	// milliseconds between drain batches
+
+typedef struct {
+	char *topic;
+	guchar *payload;
+	int len;
+	int flags;		// MQ_PUB_*
+	time_t ts;		// when the value was read
+	GList *link;		// our place in the queue
+} MqOutMsg;
+
+static GHashTable *outbox_topics;	// topic -> MqOutMsg, for the coalescing ones
+static GHashTable *outbox_every;	// topic -> number of MQ_PUB_EVERY messages queued
+static GQueue outbox_prio = G_QUEUE_INIT;
+static GQueue outbox_norm = G_QUEUE_INIT;
+static gsize outbox_bytes;
+static gsize outbox_max = OUTBOX_MAX_DEFAULT;
+static int outbox_rate = OUTBOX_RATE_DEFAULT;
+static guint outbox_drain_tag;
+static guint outbox_dropped;
+
+void
+mq_outbox_load_config(GKeyFile *kf)
+{
+	if(g_key_file_has_key(kf, "server", "outbox_max", NULL))
+		outbox_max = g_key_file_get_integer(kf, "server", "outbox_max", NULL);
+	if(g_key_file_has_key(kf, "server", "outbox_rate", NULL))
+		outbox_rate = MAX(1, g_key_file_get_integer(kf, "server", "outbox_rate", NULL));
+}
+
+static guchar *
+outbox_dup(const void *payload, int len)
+{
+	guchar *p = g_malloc(len ? len : 1);
+	memcpy(p, payload, len);
+	return p;
+}
+
+static gsize
+outbox_msg_size(MqOutMsg *m)
+{
+	return sizeof(MqOutMsg) + strlen(m->topic) + 1 + m->len;
+}
+
+static GQueue *
+outbox_queue(MqOutMsg *m)
+{
+	return (m->flags & MQ_PUB_PRIO) ? &outbox_prio : &outbox_norm;
+}
+
+// take m off its queue and out of the index, and free it
+static void
+outbox_remove(MqOutMsg *m)
+{
+	g_queue_delete_link(outbox_queue(m), m->link);
+	if(m->flags & MQ_PUB_EVERY) {
+		int n = GPOINTER_TO_INT(g_hash_table_lookup(outbox_every, m->topic));
+		if(n > 1)
+			g_hash_table_insert(outbox_every, g_strdup(m->topic), GINT_TO_POINTER(n - 1));
+		else
+			g_hash_table_remove(outbox_every, m->topic);
+	} else
+		g_hash_table_remove(outbox_topics, m->topic);
+	outbox_bytes -= outbox_msg_size(m);
+	g_free(m->topic);
+	g_free(m->payload);
+	g_free(m);
+}
+
+int
+mq_outbox_pending()
+{
+	return outbox_prio.length + outbox_norm.length;
+}
+
+// is there a message for this topic waiting?  anything newer for it must queue
+// behind that one, not overtake it.
+gboolean
+mq_outbox_holds(const char *topic)
+{
+	return mq_outbox_pending() && (g_hash_table_contains(outbox_topics, topic)
+				       || g_hash_table_contains(outbox_every, topic));
+}
+
+// queue a message; ts is when its value was read
+void
+mq_outbox_put(const char *topic, const void *payload, int len, int flags, time_t ts)
+{
+	MqOutMsg *m;
+
+	if(!outbox_topics) {
+		outbox_topics = g_hash_table_new(g_str_hash, g_str_equal);
+		outbox_every = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	}
+	if(!(flags & MQ_PUB_EVERY) && (m = g_hash_table_lookup(outbox_topics, topic))) {
+		// coalesce: keep its place in line, with the latest value
+		outbox_bytes -= m->len;
+		g_free(m->payload);
+		m->payload = outbox_dup(payload, len);
+		m->len = len;
+		m->ts = ts;
+		outbox_bytes += len;
+	} else {
+		m = g_new0(MqOutMsg, 1);
+		m->topic = g_strdup(topic);
+		m->payload = outbox_dup(payload, len);
+		m->len = len;
+		m->flags = flags;
+		m->ts = ts;
+		g_queue_push_tail(outbox_queue(m), m);
+		m->link = outbox_queue(m)->tail;
+		if(flags & MQ_PUB_EVERY)
+			g_hash_table_insert(outbox_every, g_strdup(topic),
+					    GINT_TO_POINTER(GPOINTER_TO_INT(g_hash_table_lookup(outbox_every, topic)) + 1));
+		else
+			g_hash_table_insert(outbox_topics, m->topic, m);
+		outbox_bytes += outbox_msg_size(m);
+	}
+	while(outbox_bytes > outbox_max && mq_outbox_pending() > 1) {
+		GQueue *q = outbox_norm.length ? &outbox_norm : &outbox_prio;
+		MqOutMsg *victim = g_queue_peek_head(q);
+		if(victim == m)		// never drop what we were just given
+			break;
+		if(outbox_dropped++ % 100 == 0)
+			fprintf(stderr, "mqtt outbox full: dropped %u messages so far\n", outbox_dropped);
+		outbox_remove(victim);
+	}
+}
+
+// send up to n queued messages, priority ones first
+static void
+outbox_send(int n)
+{
+	while(n-- > 0 && mq_outbox_pending() && mqtt_is_connected()) {
+		GQueue *q = outbox_prio.length ? &outbox_prio : &outbox_norm;
+		MqOutMsg *m = g_queue_peek_head(q);
+		int rc = mqtt_send(m->topic, m->payload, m->len, m->flags, m->ts);
+		if(rc != 0 && mqtt_send_retry(m->topic, rc))
+			break;		// lost the connection again; keep it for next time
+		outbox_remove(m);	// sent, or never will be
+	}
+}
+
+static gboolean
+outbox_drain_dispatch(gpointer user_data)
+{
+	outbox_send(MAX(1, outbox_rate * OUTBOX_TICK / 1000));
+	if(mq_outbox_pending() && mqtt_is_connected())
+		return G_SOURCE_CONTINUE;
+	outbox_drain_tag = 0;
+	return G_SOURCE_REMOVE;
+}
+
+// start sending what's queued.  called once connected.
+void
+mq_outbox_drain()
+{
+	if(outbox_drain_tag || !mq_outbox_pending())
+		return;
+	printf("mqtt outbox: %d messages, %lu bytes to send\n", mq_outbox_pending(), (unsigned long)outbox_bytes);
+	outbox_drain_tag = g_timeout_add(OUTBOX_TICK, outbox_drain_dispatch, NULL);
+}
+
+// send everything now, unpaced, if connected.  for shutting down, when the main
+// loop that runs the drain timer has already stopped.
+void
+mq_outbox_flush()
+{
+	if(outbox_drain_tag)
+		g_source_remove(outbox_drain_tag);
+	outbox_drain_tag = 0;
+	outbox_send(G_MAXINT);
+}
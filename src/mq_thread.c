@@ -0,0 +1,313 @@
+/*
+ * mqtt client on its own threads, with [server] mqtt_thread=true.
+ *
+ * mosquitto runs its network loop on a thread of its own (mosquitto_loop_start),
+ * and publishes are made on a second one, so serial reply handling on the main
+ * loop never takes mosquitto's lock or touches the socket.  The two directions:
+ *
+ *  main -> publisher thread: publish records are pushed on a lock-free stack
+ *	(compare-and-swap, any number of producers) and an eventfd is poked when
+ *	it goes from empty to non-empty.  The publisher thread takes the whole
+ *	stack in one exchange, reverses it back into arrival order, and hands the
+ *	batch to mosquitto.
+ *
+ *  mosquitto thread -> main: incoming commands and connect/disconnect events go
+ *	on a second stack of the same kind, with its own eventfd watched by the
+ *	main loop, where they are handled just as in the single-threaded mode.
+ *	Publishes that found the connection gone come back the same way, to be
+ *	kept in the outbox, as they would have been without the threads.
+ *
+ * Only pushes ever race with each other; taking everything at once means a
+ * node is never popped and pushed back, so there's no ABA to worry about.
+ * Topic alias state belongs to the publisher thread; the main loop resets it
+ * by sending a record down the same queue, so it lands in order.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <glib.h>
+#include <glib-unix.h>
+#include <mqoms.h>
+
+enum {
+	// to the publisher thread
+	MQT_PUBLISH,
+	MQT_REPLY,
+	MQT_ALIASES,	// forget topic aliases; n is how many the new connection allows
+	MQT_STOP,
+	// to the main loop
+	MQT_MESSAGE,
+	MQT_CONNECT,	// n is the connack code, aux the alias maximum
+	MQT_DISCONNECT,
+	MQT_UNSENT,	// a publish that couldn't go out for want of a connection
+};
+
+typedef struct _MqRec MqRec;
+struct _MqRec {
+	MqRec *next;
+	int kind;
+	char *topic;
+	guchar *payload;
+	int len;
+	int flags;		// MQ_PUB_*
+	time_t ts;
+	MqReplyTo *rt;		// MQT_REPLY, and v5 commands asking for one
+	int n, aux;
+};
+
+typedef struct {
+	MqRec *head;
+	int efd;
+} MqStack;
+
+static MqStack mqt_out = { NULL, -1 };	// main -> publisher
+static MqStack mqt_in = { NULL, -1 };	// mosquitto thread -> main
+static GThread *mqt_publisher;
+static guint mqt_in_tag;
+
+static void
+mqt_wake(int efd)
+{
+	uint64_t one = 1;
+	while(write(efd, &one, sizeof(one)) < 0 && errno == EINTR)
+		;
+}
+
+static void
+mqt_push(MqStack *s, MqRec *r)
+{
+	MqRec *old = __atomic_load_n(&s->head, __ATOMIC_RELAXED);
+	do {
+		r->next = old;
+	} while(!__atomic_compare_exchange_n(&s->head, &old, r, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	// the consumer clears the eventfd before taking, so only the first push needs to wake it
+	if(!old)
+		mqt_wake(s->efd);
+}
+
+// everything pushed so far, oldest first
+static MqRec *
+mqt_take(MqStack *s)
+{
+	MqRec *r = __atomic_exchange_n(&s->head, NULL, __ATOMIC_ACQUIRE);
+	MqRec *fifo = NULL;
+	while(r) {
+		MqRec *next = r->next;
+		r->next = fifo;
+		fifo = r;
+		r = next;
+	}
+	return fifo;
+}
+
+static guchar *
+mqt_dup(const void *p, int len)
+{
+	guchar *d = g_malloc(len + 1);
+	memcpy(d, p, len);
+	d[len] = 0;		// commands are parsed as strings
+	return d;
+}
+
+static MqReplyTo *
+mqt_reply_to_dup(const MqReplyTo *rt)
+{
+	MqReplyTo *d;
+	if(!rt || !rt->topic)
+		return NULL;
+	d = g_new0(MqReplyTo, 1);
+	d->topic = g_strdup(rt->topic);
+	if(rt->corr) {
+		d->corr = mqt_dup(rt->corr, rt->corrlen);
+		d->corrlen = rt->corrlen;
+	}
+	return d;
+}
+
+static void
+mqt_rec_free(MqRec *r)
+{
+	g_free(r->topic);
+	g_free(r->payload);
+	if(r->rt)
+		mq_reply_to_free(r->rt);
+	g_free(r);
+}
+
+static gpointer
+mqt_publisher_main(gpointer data)
+{
+	for(;;) {
+		uint64_t n;
+		if(read(mqt_out.efd, &n, sizeof(n)) < 0 && errno != EINTR) {
+			perror("mqtt publisher: eventfd read");
+			return NULL;
+		}
+		for(MqRec *r = mqt_take(&mqt_out), *next; r; r = next) {
+			int rc;
+			next = r->next;
+			switch(r->kind) {
+			case MQT_PUBLISH:
+				rc = mqtt_send_now(r->topic, r->payload, r->len, r->flags, r->ts);
+				if(rc != 0 && mqtt_send_retry(r->topic, rc)) {
+					r->kind = MQT_UNSENT;
+					mqt_push(&mqt_in, r);	// the main loop keeps it for later
+					continue;
+				}
+				break;
+			case MQT_REPLY:
+				mqtt_publish_reply_now(r->rt, (char *)r->payload, r->len);
+				break;
+			case MQT_ALIASES:
+				mqtt_alias_reset(r->n);
+				break;
+			case MQT_STOP:
+				// anything behind it was pushed after shutdown began
+				for(; r; r = next) {
+					next = r->next;
+					mqt_rec_free(r);
+				}
+				return NULL;
+			}
+			mqt_rec_free(r);
+		}
+	}
+}
+
+static gboolean
+mqt_in_dispatch(gint fd, GIOCondition cond, gpointer user_data)
+{
+	uint64_t n;
+	if(read(fd, &n, sizeof(n)) < 0 && errno != EAGAIN && errno != EINTR)
+		perror("mqtt: eventfd read");
+	for(MqRec *r = mqt_take(&mqt_in), *next; r; r = next) {
+		next = r->next;
+		switch(r->kind) {
+		case MQT_MESSAGE:
+			mq_recv_message(r->topic, r->payload, r->len, r->rt);
+			break;
+		case MQT_CONNECT:
+			mqtt_connected_main(r->n, r->aux);
+			break;
+		case MQT_DISCONNECT:
+			mqtt_disconnected_main();
+			break;
+		case MQT_UNSENT:
+			mq_outbox_put(r->topic, r->payload, r->len, r->flags, r->ts);
+			if(mqtt_is_connected())
+				mq_outbox_drain();
+			break;
+		}
+		mqt_rec_free(r);
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+// set up the queues and the publisher thread.  call before mosquitto_loop_start.
+int
+mq_thread_start()
+{
+	mqt_out.efd = eventfd(0, EFD_CLOEXEC);
+	mqt_in.efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if(mqt_out.efd < 0 || mqt_in.efd < 0) {
+		perror("mqtt: eventfd");
+		return -1;
+	}
+	mqt_in_tag = g_unix_fd_add(mqt_in.efd, G_IO_IN, mqt_in_dispatch, NULL);
+	mqt_publisher = g_thread_new("mqtt-publish", mqt_publisher_main, NULL);
+	return 0;
+}
+
+// let the publisher thread finish what it has, and wait for it
+void
+mq_thread_stop()
+{
+	if(!mqt_publisher)
+		return;
+	MqRec *r = g_new0(MqRec, 1);
+	r->kind = MQT_STOP;
+	mqt_push(&mqt_out, r);
+	g_thread_join(mqt_publisher);
+	mqt_publisher = NULL;
+	if(mqt_in_tag)
+		g_source_remove(mqt_in_tag);
+	mqt_in_tag = 0;
+	for(MqRec *next; (r = mqt_take(&mqt_in)); ) {
+		for(; r; r = next) {
+			next = r->next;
+			mqt_rec_free(r);
+		}
+	}
+	close(mqt_out.efd);
+	close(mqt_in.efd);
+	mqt_out.efd = mqt_in.efd = -1;
+}
+
+// main loop side: queue a publish, copying what it needs
+void
+mq_thread_publish(const char *topic, const void *payload, int len, int flags, time_t ts)
+{
+	MqRec *r = g_new0(MqRec, 1);
+	r->kind = MQT_PUBLISH;
+	r->topic = g_strdup(topic);
+	r->payload = mqt_dup(payload, len);
+	r->len = len;
+	r->flags = flags;
+	r->ts = ts;
+	mqt_push(&mqt_out, r);
+}
+
+void
+mq_thread_reply(const MqReplyTo *rt, const char *payload, int len)
+{
+	MqRec *r = g_new0(MqRec, 1);
+	r->kind = MQT_REPLY;
+	r->rt = mqt_reply_to_dup(rt);
+	r->payload = mqt_dup(payload, len);
+	r->len = len;
+	mqt_push(&mqt_out, r);
+}
+
+void
+mq_thread_reset_aliases(int alias_max)
+{
+	MqRec *r = g_new0(MqRec, 1);
+	r->kind = MQT_ALIASES;
+	r->n = alias_max;
+	mqt_push(&mqt_out, r);
+}
+
+// mosquitto thread side: hand an incoming message to the main loop
+void
+mq_thread_post_message(const char *topic, const void *payload, int len, const MqReplyTo *rt)
+{
+	MqRec *r = g_new0(MqRec, 1);
+	r->kind = MQT_MESSAGE;
+	r->topic = g_strdup(topic);
+	r->payload = mqt_dup(payload, len);
+	r->len = len;
+	r->rt = mqt_reply_to_dup(rt);
+	mqt_push(&mqt_in, r);
+}
+
+void
+mq_thread_post_connect(int rc, int alias_max)
+{
+	MqRec *r = g_new0(MqRec, 1);
+	r->kind = MQT_CONNECT;
+	r->n = rc;
+	r->aux = alias_max;
+	mqt_push(&mqt_in, r);
+}
+
+void
+mq_thread_post_disconnect()
+{
+	MqRec *r = g_new0(MqRec, 1);
+	r->kind = MQT_DISCONNECT;
+	mqt_push(&mqt_in, r);
+}
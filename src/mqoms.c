@@ -24,6 +24,17 @@ extern 	OmsChan *g_omc;
 extern int g_verbose;
 
 void oms_chan_reply_getg(OmsNode *nd, OmsMessage *msg);
+static void oms_setreq_cancel(OmsMessage *msg);
+
+GPtrArray *oms_chans;	// all open channels
+
+// name -> node index across all channels.  keys are OmsNameKey, so a lookup can be
+// made straight from a topic segment without copying it.
+typedef struct {
+	const char *s;
+	int len;
+} OmsNameKey;
+static GHashTable *oms_node_index;
 int timeval_subtract (struct timeval *result,
 		      struct timeval *a,
 		      struct timeval *b);
@@ -67,17 +78,67 @@ OmsChan *oms_chan_open(char *devname)
 	omc->fname = g_strdup(devname);
 	omc->fd = fd;
 	omc->timeout = 1250; // milliseconds
+	omc->nodelist = g_ptr_array_new();
+	if(!oms_chans)
+		oms_chans = g_ptr_array_new();
+	g_ptr_array_add(oms_chans, omc);
+	return omc;
 }
 
 void oms_chan_close(OmsChan *omc)
 {
 	tty_close(omc->fd);
+	oms_chan_boost_stop(omc);
 	if(omc->totimer) {
 		g_source_remove(omc->totimer);
 		omc->totimer = 0;
 	}
 }
 
+static guint
+oms_name_hash(gconstpointer p)
+{
+	const OmsNameKey *k = p;
+	guint h = 5381;
+	for(int i = 0; i < k->len; i++)
+		h = h * 33 + (guchar)k->s[i];
+	return h;
+}
+
+static gboolean
+oms_name_equal(gconstpointer a, gconstpointer b)
+{
+	const OmsNameKey *ka = a, *kb = b;
+	return ka->len == kb->len && memcmp(ka->s, kb->s, ka->len) == 0;
+}
+
+// find a node by name, on any channel.  name need not be NUL-terminated.
+OmsNode *
+oms_node_lookup(const char *name, int len)
+{
+	OmsNameKey key = { name, len };
+	if(!oms_node_index)
+		return NULL;
+	return g_hash_table_lookup(oms_node_index, &key);
+}
+
+// can name be a node's?  it goes into topics, as one level, and into JSON documents
+// unescaped, and server and group are taken by the server's own topics.
+// returns NULL if it's fine, or why not.
+const char *
+oms_node_name_check(const char *name)
+{
+	if(!name || !name[0])
+		return "empty name";
+	if(strcmp(name, "server") == 0 || strcmp(name, "group") == 0)
+		return "reserved name";
+	for(const char *p = name; *p; p++) {
+		if(*p == '/' || *p == '+' || *p == '#' || *p == '"' || *p == '\\' || (guchar)*p < 0x20)
+			return "name can't contain / + # \" \\ or control characters";
+	}
+	return NULL;
+}
+
 OmsNode *
 oms_chan_add_node(OmsChan *omc, guint addr, char *name)
 {
@@ -86,33 +147,95 @@ oms_chan_add_node(OmsChan *omc, guint addr, char *name)
 		return NULL;
 	}
 	addr &= 0x7f;
+	// check everything before replacing anything
+	OmsNode *old = oms_node_lookup(name, strlen(name));
+	if(old && old != omc->nodes[addr]) {
+		fprintf(stderr, "oms_chan_add_node: node name %s already in use\n", name);
+		return NULL;
+	}
 	if(omc->nodes[addr]) {
 		fprintf(stderr, "oms_chan_add_node: warning overwriting existing node addresss %d for node named %s\n", addr, name);
-		g_free(omc->nodes[addr]);
+		oms_chan_remove_node(omc, omc->nodes[addr]);
 	}
+	if(!oms_node_index)
+		oms_node_index = g_hash_table_new_full(oms_name_hash, oms_name_equal, g_free, NULL);
 	OmsNode *nd = g_new0(OmsNode, 1);
 	omc->nodes[addr] = nd;
 	nd->omc = omc;
 	nd->addr = addr;
 	nd->name = g_strdup(name);
+	oms_nd_topics_init(nd);
+	g_ptr_array_add(omc->nodelist, nd);
+
+	OmsNameKey *key = g_new0(OmsNameKey, 1);
+	key->s = nd->name;
+	key->len = strlen(nd->name);
+	g_hash_table_insert(oms_node_index, key, nd);
 	return nd;
 }
 
+// take a node off the channel, dropping anything still queued for it
+void
+oms_chan_remove_node(OmsChan *omc, OmsNode *nd)
+{
+	GList *l, *next;
+	OmsNameKey key = { nd->name, strlen(nd->name) };
+
+	// the outstanding message goes first: a set's write may be on the wire with its
+	// read-back still queued, and cancelling the read-back frees what they share
+	if(omc->outstanding && omc->outstanding->nodeno == nd->addr) {
+		oms_setreq_cancel(omc->outstanding);
+		omc->outstanding->done = NULL;	// reply, if any, will find no node
+	}
+	for(l = omc->sendq; l; l = next) {
+		next = l->next;
+		OmsMessage *msg = l->data;
+		if(msg->nodeno == nd->addr) {
+			omc->sendq = g_list_delete_link(omc->sendq, l);
+			oms_setreq_cancel(msg);
+			g_free(msg);
+		}
+	}
+	oms_nd_snapshot_cancel(nd);
+	oms_wjob_cancel(nd);
+
+	omc->nodes[nd->addr] = NULL;
+	g_ptr_array_remove(omc->nodelist, nd);
+	g_hash_table_remove(oms_node_index, &key);
+	oms_nd_topics_free(nd);
+	oms_nd_doc_free(nd);
+	oms_nd_runtime_free(nd);
+	oms_nd_hist_free(nd);
+	g_free(nd->name);
+	g_free(nd);
+}
+
 // print list of configured nodes
 void
 oms_chan_dump_nodes(OmsChan *omc)
 {
-	int a;
 	printf("Channel %s\n", omc->fname);
-	for(a = 0; a < 128; a++) {
-		if(omc->nodes[a]) {
-			OmsNode *nd = omc->nodes[a];
-			printf("  [%d] \"%s\" state=%d\n", a, nd->name, nd->state);
-		}
+	for(int i = 0; i < omc->nodelist->len; i++) {
+		OmsNode *nd = g_ptr_array_index(omc->nodelist, i);
+		printf("  [%d] \"%s\" state=%d\n", nd->addr, nd->name, nd->state);
 	}
 }
 
 
+/*
+ * keep a running average of how long a transaction holds the bus, timeouts included,
+ * for anything that wants to pace itself against the channel's load
+ */
+static void
+oms_chan_note_bus(OmsChan *omc, OmsMessage *msg)
+{
+	gint64 t;
+	if(!msg->sendtime)
+		return;
+	t = g_get_monotonic_time() - msg->sendtime;
+	omc->bus_us_avg = omc->bus_us_avg ? (omc->bus_us_avg * 7 + t) / 8 : t;
+}
+
 /*
  * Clear a channel that is waiting for a reply so that it can be used
  * to send another message.  The next message in the queue is sent.
@@ -132,11 +255,16 @@ oms_chan_clear(void *p)
 		omc->totimer = 0;
 	}
 	if(omc->outstanding) {
-		oms_chan_timeout_handler(omc, omc->outstanding, KE_TIMEOUT);
-		g_free(omc->outstanding);
+		OmsMessage *msg = omc->outstanding;
 		omc->outstanding = NULL;
+		oms_chan_note_bus(omc, msg);
+		oms_chan_timeout_handler(omc, msg, KE_TIMEOUT);
+		if(msg->done)
+			msg->done(msg, KE_TIMEOUT);
+		g_free(msg);
 	}
-	oms_chan_dispatch(omc);
+	if(omc->state == KCH_STATE_IDLE)  // timeout handler may have sent something already
+		oms_chan_dispatch(omc);
 	return FALSE;
 }
 
@@ -193,6 +321,7 @@ oms_chan_dispatch(OmsChan *omc)
         }
 
         write(omc->fd, pbuf, plen);
+	msg->sendtime = g_get_monotonic_time();
 
         omc->outstanding = msg;
         omc->state = KCH_STATE_RECV;
@@ -245,8 +374,10 @@ oms_chan_recv(OmsChan *omc)
                         omc->rcrc += c;
                         omc->rlen = (c >> 4) & 0x0f;
                         omc->rstatus = c & 0x0f;
-			msg->rstatus = omc->rstatus;
-			msg->rlength = 0;  // incremented below per data byte
+			if(msg) {
+				msg->rstatus = omc->rstatus;
+				msg->rlength = 0;  // incremented below per data byte
+			}
 			
                         if(omc->rlen == 0)
                                 omc->state = KCH_STATE_CKSUM;
@@ -288,13 +419,29 @@ oms_chan_recv(OmsChan *omc)
 				g_source_remove(omc->totimer);
 				omc->totimer = 0;
 			}
+			omc->outstanding = NULL;
+			oms_chan_note_bus(omc, msg);
 			oms_chan_dispatch(omc);
 			oms_chan_reply_handler(omc, msg, err);
+			if(msg->done)
+				msg->done(msg, err);
+			g_free(msg);
+			msg = omc->outstanding;  // any further bytes belong to the next one
                         break;
                 }
         }
 }
 
+// a register read got no data back, so let oms_nd_read_static try these again
+static void
+oms_nd_read_failed(OmsNode *nd, OmsMessage *msg)
+{
+	if(msg->sdata[0] != OMMT_GETREG)
+		return;
+	for(int r = msg->sdata[1]; r < msg->sdata[1] + msg->sdata[2] && r < 256; r++)
+		nd->reg_cache[r].flags &= ~READ_PENDING;
+}
+
 // called when there was a timeout waiting for reply
 void
 oms_chan_timeout_handler(OmsChan *omc, OmsMessage *msg, int err)
@@ -309,6 +456,7 @@ oms_chan_timeout_handler(OmsChan *omc, OmsMessage *msg, int err)
 	}
 	nd = omc->nodes[nodeno];
 	printf("timeout on %s for node %d/%s\n", omc->fname, nd->addr, nd->name);
+	oms_nd_read_failed(nd, msg);
 	oms_nd_update_state(nd);   // might declare the node dead
 }
 
@@ -331,10 +479,9 @@ oms_chan_reply_handler(OmsChan *omc, OmsMessage *msg, int err)
 		switch(mt) {
 		case OMMS_ACK:	// ACK  (likely successful reg write)
 			break;
-		case OMMS_NACK:	// NAK  (likely invalid register address)
-			break;
 		case OMMS_DATA:  // register returndata
 			oms_chan_reply_regdata(nd, msg);
+			oms_nd_doc_update(nd);
 			break;
 		case OMMS_GRP1: // group 1 data
 			oms_chan_reply_getg(nd, msg);
@@ -351,6 +498,14 @@ oms_chan_reply_handler(OmsChan *omc, OmsMessage *msg, int err)
 		if(omc->flags & KCH_FLAG_VERBOSE)
 			fprintf(stderr, "oms_reply_handler err=%d\n", err);
 			oms_msg_print(msg, "oms_reply_handler:error");
+		nd = omc->nodes[msg->nodeno];
+		if(nd)
+			oms_nd_read_failed(nd, msg);
+		if(err == KE_BADADDR && nd) {
+			// someone else answered; don't trust what we think we know about this node.
+			oms_nd_invalidate_static(nd);
+			oms_nd_read_static(nd);
+		}
 	}
 }
 
@@ -367,14 +522,17 @@ oms_chan_reply_getg(OmsNode *nd, OmsMessage *msg)
 	nd->mode = msg->rbuf[2];
 	nd->fanmode = msg->rbuf[3];
 	nd->hold = msg->rbuf[4];
+	oms_nd_bin_publish(nd, OM_REGADDR_STATUS, msg->rbuf, 6);	// group 1 is registers 0x3B-0x40
 
 	char dbuf[64];
-	char topic[128];
+	int dlen;
 
 	nd->cur_temp = omcf_temp(msg->rbuf[5], 1);
-	sprintf(dbuf, "%.1f", nd->cur_temp);
-	sprintf(topic, "omnistat/%s/current", nd->name);
-	mqtt_publish(topic, dbuf);
+	if(!oms_doc_only() && oms_nd_pub_filter(nd, OM_REGADDR_CURRENT_TEMP, msg->rbuf[5])) {
+		dlen = sprintf(dbuf, "%.1f", nd->cur_temp);
+		mqtt_publish_topic(&nd->t_current, dbuf, dlen);
+	}
+	oms_nd_doc_update_grp1(nd, msg->rbuf);
 	
 	if(nd->omc->flags & KCH_FLAG_VERBOSE) {
 		omcs_temp(dbuf, msg->rbuf[0]);
@@ -404,6 +562,7 @@ oms_chan_reply_regdata(OmsNode *nd, OmsMessage *msg)
 	for(int i = 0; i < msg->rlength-1; i++) {
 		oms_nd_regdata(nd, startreg+i, msg->rbuf[i+1]);
 	}
+	oms_nd_bin_publish(nd, startreg, msg->rbuf+1, msg->rlength-1);
 }
 
 // store and optionally publish register value
@@ -411,12 +570,18 @@ void
 oms_nd_regdata(OmsNode *nd, guint regaddr, guchar val)
 {
 	int model;
-	if(regaddr == OM_REGADDR_MODEL)
+	if(regaddr == OM_REGADDR_MODEL) {
+		if(nd->reg_cache[regaddr].vtime && val != nd->reg_cache[regaddr].val) {
+			fprintf(stderr, "omnistat(%s) model changed from %d to %d\n",
+				nd->name, nd->reg_cache[regaddr].val, val);
+			oms_nd_invalidate_static(nd);
+		}
 		nd->model = val;
+		oms_nd_topics_model(nd);
+	}
 	model = nd->model;   // special case because we need the model code to do the others!
 
 	char dbuf[MQSTRSIZE];
-	char topic[MQSTRSIZE];
 	
 	struct omst_reg *regtab = om_model_table(model);
 	int max_regs = om_model_table_size(model);
@@ -424,32 +589,119 @@ oms_nd_regdata(OmsNode *nd, guint regaddr, guchar val)
 		printf("%s reg[0x%02x]: newval 0x%02x regtab=%p\n", nd->name, regaddr, val, regtab);
 	}
 	if(regtab && regaddr < max_regs) {
-		if(regtab[regaddr].flags & PUBA
-		   || (nd->reg_cache[regaddr].flags & PUB_NEXT)
-		   || ( (regtab[regaddr].flags & PUBC)
-			&& (val != nd->reg_cache[regaddr].val))
-		   || ( (regtab[regaddr].flags & PUBC)
-			&& (nd->reg_cache[regaddr].vtime < 10)) ) {
-			snprintf(topic, MQSTRSIZE, "omnistat/%s/%s", nd->name, regtab[regaddr].topic);
+		if(nd->t_reg && nd->t_reg_model == model && !oms_doc_only() && oms_nd_pub_filter(nd, regaddr, val)) {
 			omcs_regval(dbuf, regaddr, val, model);
-			mqtt_publish(topic, dbuf);
-			nd->reg_cache[regaddr].flags &= ~PUB_NEXT;
+			mqtt_publish_topic(&nd->t_reg[regaddr], dbuf, strlen(dbuf));
 		}
 	}
 
 	nd->reg_cache[regaddr].val = val;
 	nd->reg_cache[regaddr].vtime = time(NULL);
+	nd->reg_cache[regaddr].flags &= ~READ_PENDING;
 
 	if(regaddr == OM_REGADDR_CURRENT_TEMP) {
 		nd->cur_temp = omcf_temp(val, 1);
 	}
+	if(regaddr == OM_REGADDR_OUTPUT_STATE)
+		oms_nd_runtime_sample(nd, val);
+	oms_nd_hist_sample(nd, regaddr, val);
+	oms_nd_store_sample(nd, regaddr, val);
+	if(regaddr == OM_REGADDR_ADDRESS && val != nd->addr) {
+		// device is confused or not the one we think; re-learn everything but the address,
+		// so that we don't loop re-reading it.
+		fprintf(stderr, "omnistat(%s) address register reads %d, expected %d\n",
+			nd->name, val, nd->addr);
+		oms_nd_invalidate_static(nd);
+		nd->reg_cache[regaddr].vtime = time(NULL);
+	}
+	if(regaddr == OM_REGADDR_MODEL) {  // now we know which table to use for the rest
+		oms_nd_read_static(nd);
+	}
+}
+
+// register flags from the node's model table.
+// before the model is known, use the RC-8x table; the low registers
+// through the model register are laid out the same on all models.
+int
+oms_nd_reg_flags(OmsNode *nd, guint regaddr)
+{
+	struct omst_reg *regtab = om_model_table(nd->model);
+	int max_regs = om_model_table_size(nd->model);
+	if(!regtab) {
+		regtab = rc8x_regs;
+		max_regs = rc8x_nregs;
+	}
+	if(regaddr < max_regs)
+		return regtab[regaddr].flags;
+	else
+		return RESV;
+}
+
+// is the cached value of a register recent enough to use instead of reading it?
+// static registers are good until invalidated, slow ones for about an hour,
+// everything else only for a couple of polling intervals.
+int
+oms_nd_reg_fresh(OmsNode *nd, guint regaddr)
+{
+	time_t vtime = nd->reg_cache[regaddr].vtime;
+	int flags = oms_nd_reg_flags(nd, regaddr);
+	if(vtime == 0)
+		return 0;
+	if(flags & STC)
+		return 1;
+	if(flags & SLW)
+		return (time(NULL) - vtime) < 3700;
+	return (time(NULL) - vtime) < 130;
+}
+
+// forget static register values, so that they get read again.
+// called at the start of each node life cycle, and when replies suggest that the
+// device at this address has changed.
+void
+oms_nd_invalidate_static(OmsNode *nd)
+{
+	for(int r = 0; r < 256; r++) {
+		if(oms_nd_reg_flags(nd, r) & STC) {
+			nd->reg_cache[r].vtime = 0;
+			nd->reg_cache[r].flags &= ~READ_PENDING;
+		}
+	}
+}
+
+// queue reads for any static registers we don't have a value for yet,
+// in contiguous runs.  Reads already in flight are not repeated.
+void
+oms_nd_read_static(OmsNode *nd)
+{
+	int start = -1;
+	int max_regs = om_model_table_size(nd->model);
+	if(max_regs == 0)
+		max_regs = rc8x_nregs;
+	for(int r = 0; r <= max_regs; r++) {
+		int want = 0;
+		if(r < max_regs) {
+			int flags = oms_nd_reg_flags(nd, r);
+			want = (flags & STC) && (flags & ROK)
+				&& nd->reg_cache[r].vtime == 0
+				&& !(nd->reg_cache[r].flags & READ_PENDING);
+		}
+		if(start >= 0 && (!want || r - start == 14)) {
+			oms_node_send_msg_readregs(nd, start, r - start);
+			start = -1;
+		}
+		if(want) {
+			nd->reg_cache[r].flags |= READ_PENDING;
+			if(start < 0)
+				start = r;
+		}
+	}
 }
 
 void
 oms_chan_enqueue_msg(OmsChan *omc, OmsMessage *msg)
 {
 	msg->omc = omc;
-	msg->qtime = time(NULL);
+	msg->qtime = g_get_monotonic_time();
 	if(omc->flags & KCH_FLAG_VERBOSE) {
 		printf("enqueue mid=%d cmd=%d\n", msg->id, msg->sdata[0]);
 	}
@@ -501,7 +753,7 @@ oms_chan_print(OmsChan *omc)
 /*
  * create message structure, fill in the message body, and enqueue it.
  */
-void
+OmsMessage *
 oms_chan_send_msg(OmsChan *omc, int addr, int scmd, unsigned char *sbuf, int sblen)
 {
 	static guint msgid;
@@ -512,9 +764,10 @@ oms_chan_send_msg(OmsChan *omc, int addr, int scmd, unsigned char *sbuf, int sbl
 	msg->slength = slength;
 	msg->sdata[0] = scmd & 0x0f;
 	if(slength > 1)
-		memcpy(&msg->sdata[1], sbuf, slength);
+		memcpy(&msg->sdata[1], sbuf, slength-1);
 
 	oms_chan_enqueue_msg(omc, msg);
+	return msg;
 }
 
 /* send a "get group 1" message */
@@ -540,7 +793,7 @@ oms_node_send_msg_getg(OmsNode *nd)
 	oms_chan_send_msg_getg(omc, addr);
 }
 
-void
+OmsMessage *
 oms_node_send_msg_readregs(OmsNode *nd, int startreg, unsigned int count)
 {
 	OmsChan *omc = nd->omc;
@@ -551,10 +804,42 @@ oms_node_send_msg_readregs(OmsNode *nd, int startreg, unsigned int count)
 		count = 14;
 	sbuf[1] = count;
 
-	oms_chan_send_msg(omc, nd->addr, msgtype, sbuf, 2);
+	return oms_chan_send_msg(omc, nd->addr, msgtype, sbuf, 2);
 }
 
-void
+/*
+ * plan the fewest OMMT_GETREG transactions (14 registers max each) that cover every
+ * register marked in want[0..nregs-1].  A read may span registers that aren't
+ * wanted, such as reserved ones, but never starts or ends on one.
+ * fills in starts[] and counts[], and returns the number of reads, or -1 if
+ * more than maxreads would be needed.
+ */
+int
+oms_plan_reads(const guchar *want, int nregs, int *starts, int *counts, int maxreads)
+{
+	int n = 0;
+	int r = 0;
+	while(r < nregs) {
+		if(!want[r]) {
+			r++;
+			continue;
+		}
+		int end = MIN(r + 14, nregs);
+		int last = r;
+		for(int i = r; i < end; i++)
+			if(want[i])
+				last = i;
+		if(n >= maxreads)
+			return -1;
+		starts[n] = r;
+		counts[n] = last - r + 1;
+		n++;
+		r = end;
+	}
+	return n;
+}
+
+OmsMessage *
 oms_node_send_msg_setregs(OmsNode *nd, unsigned char *sbuf, unsigned int count)
 /* first byte is starting register address, rest are data.
    count includes starting register address.
@@ -565,7 +850,7 @@ oms_node_send_msg_setregs(OmsNode *nd, unsigned char *sbuf, unsigned int count)
 	unsigned char msgtype = OMMT_SETREG;
 	if(count > 15)
 		count = 15;
-	oms_chan_send_msg(omc, nd->addr, msgtype, sbuf, count);
+	return oms_chan_send_msg(omc, nd->addr, msgtype, sbuf, count);
 }
 
 /* set a thermostat's time from system clock */
@@ -617,24 +902,26 @@ oms_nd_update_state(OmsNode *nd)
 				fprintf(stderr, "omnistat(%s) dead: %d seconds since last reponse (oldstate=%d)\n",
 					nd->name,  (now - nd->last_resp), oldstate );
 			}
-			char topic[128];
-			sprintf(topic, "omnistat/%s/state", nd->name);
-			mqtt_publish(topic, "dead");
-			// require recent model to call it alive again
-			nd->reg_cache[OM_REGADDR_MODEL].vtime = 0;
+			mqtt_publish_topic(&nd->t_state, "dead", 4);
+			// new life cycle when it comes back: static registers, including the model, get read again,
+			// and everything is published afresh
+			oms_nd_invalidate_static(nd);
+			oms_nd_pub_reset(nd);
+			oms_nd_doc_update(nd);
 		}
 	}
 	if( (now - nd->last_resp) < 10) {  // some recent reply
-		int recent_model  = (now - nd->reg_cache[OM_REGADDR_MODEL].vtime  < 3700);
-		int recent_temp  = (now - nd->reg_cache[OM_REGADDR_CURRENT_TEMP].vtime  < 130);
+		int recent_model  = oms_nd_reg_fresh(nd, OM_REGADDR_MODEL);
+		time_t temp_time = nd->reg_cache[OM_REGADDR_CURRENT_TEMP].vtime;
+		int recent_temp  = temp_time && now - temp_time < oms_poll_alive_age();
 		
 		// if recent device model and recent temp status, its alive
 		if( recent_model && recent_temp) {
 			nd->state = NODE_ALIVE;
 		} else {
 			nd->state = NODE_WAKEUP;
-			if(!recent_model) { // if not recent device model message, ask for it
-				oms_node_send_msg_readregs(nd, OM_REGADDR_MODEL, 1);
+			if(!recent_model) { // if no device model this life cycle, ask for it
+				oms_nd_read_static(nd);
 			}
 			if(!recent_temp) { // if not recent temp status, query for that
 				oms_node_send_msg_readregs(nd, OM_REGADDR_STATUS, OM_REGADDR_STATUS_LEN);
@@ -647,9 +934,8 @@ oms_nd_update_state(OmsNode *nd)
 				if(g_verbose) { // TODO verbose per node? inherit from channel?
 					fprintf(stderr, "omnistat(%s) alive\n", nd->name);
 				}
-				char topic[128];
-				sprintf(topic, "omnistat/%s/state", nd->name);
-				mqtt_publish(topic, "alive");
+				mqtt_publish_topic(&nd->t_state, "alive", 5);
+				oms_nd_doc_update(nd);
 				oms_node_set_clock(nd);
 			}
 		}
@@ -662,13 +948,12 @@ oms_nd_update_state(OmsNode *nd)
 void
 oms_list_per_minute()
 {
-	OmsChan *omc = g_omc;
 	OmsNode *nd;
-	int i;
-	for(i = 1; i < 128; i++) {
-		if(omc->nodes[i]) {
-			nd = omc->nodes[i];
-//			if(nd->state == NODE_ALIVE) 
+	for(int c = 0; oms_chans && c < oms_chans->len; c++) {
+		OmsChan *omc = g_ptr_array_index(oms_chans, c);
+		for(int i = 0; i < omc->nodelist->len; i++) {
+			nd = g_ptr_array_index(omc->nodelist, i);
+			if(oms_poll_swept(nd))
 				oms_node_send_msg_readregs(nd, OM_REGADDR_STATUS, OM_REGADDR_STATUS_LEN);
 		}
 	}
@@ -677,14 +962,29 @@ oms_list_per_minute()
 void
 oms_list_per_hour()
 {
-	OmsChan *omc = g_omc;
 	OmsNode *nd;
-	int i;
-	for(i = 1; i < 128; i++) {
-		if(omc->nodes[i]) {
-			nd = omc->nodes[i];
+	for(int c = 0; oms_chans && c < oms_chans->len; c++) {
+		OmsChan *omc = g_ptr_array_index(oms_chans, c);
+		for(int i = 0; i < omc->nodelist->len; i++) {
+			nd = g_ptr_array_index(omc->nodelist, i);
 			oms_node_set_clock(nd);
-			oms_node_send_msg_readregs(nd, OM_REGADDR_MODEL, 1);
+			oms_nd_read_static(nd);  // normally nothing to do; retries failed reads
+		}
+	}
+}
+
+// (re)connected to the broker: publish every node's state and cached values right
+// away, rather than leaving subscribers waiting for the next poll.  it all goes through
+// the outbox, which paces it.
+void
+oms_list_broker_connected()
+{
+	OmsNode *nd;
+	for(int c = 0; oms_chans && c < oms_chans->len; c++) {
+		OmsChan *omc = g_ptr_array_index(oms_chans, c);
+		for(int i = 0; i < omc->nodelist->len; i++) {
+			nd = g_ptr_array_index(omc->nodelist, i);
+			oms_nd_republish(nd);
 		}
 	}
 }
@@ -693,17 +993,14 @@ oms_list_per_hour()
 void
 oms_list_goodbye()
 {
-	OmsChan *omc = g_omc;
 	OmsNode *nd;
-	int i;
-	for(i = 1; i < 128; i++) {
-		if(omc->nodes[i]) {
-			nd = omc->nodes[i];
+	for(int c = 0; oms_chans && c < oms_chans->len; c++) {
+		OmsChan *omc = g_ptr_array_index(oms_chans, c);
+		for(int i = 0; i < omc->nodelist->len; i++) {
+			nd = g_ptr_array_index(omc->nodelist, i);
 			if(nd->state != NODE_DEAD) {
-				char topic[128];
 				nd->state = NODE_DEAD;
-				sprintf(topic, "omnistat/%s/state", nd->name);
-				mqtt_publish(topic, "dead");
+				mqtt_publish_topic(&nd->t_state, "dead", 4);
 			}
 		}
 	}
@@ -772,62 +1069,156 @@ per_minute_init()
 OmsNode *
 mqoms_find_node(OmsChan *omc, char *name)
 {
-	for(int i = 0; i < 128; i++) {
-		if(omc->nodes[i]) 
-			if(strcmp(omc->nodes[i]->name, name) == 0)
-				return omc->nodes[i];
-	}
+	OmsNode *nd = oms_node_lookup(name, strlen(name));
+	if(nd && nd->omc == omc)
+		return nd;
 	return NULL;
 }
 
+// set a thermostat register to a new value
+// register name and new value are both strings to be looked up and converted
+// to register number and binary-byte value
 void
-mq_recv_message(char *topic, char *payload)
+oms_nd_set_reg_str(OmsNode *nd, char *regname, char *valstr)
 {
-	char *me = strtok(topic, "/");
-	if(strcmp(me, "omnistat") != 0)
-		return;
-	char *tstatname = strtok(NULL, "/");
-	char *cmd = strtok(NULL, "/");
+	oms_nd_set_reg_req(nd, regname, valstr, NULL, NULL);
+}
 
-	if(strcmp(cmd, "getreg") != 0
-		&& strcmp(cmd, "set") != 0)  // early reject of things we don't respond to, including things we send!
-		return;
-	
-	char *regname = strtok(NULL, "/");
+// one set command, followed through its write and read-back
+typedef struct {
+	OmsNode *nd;
+	char *reg;		// as named in the command
+	char *id;		// client's correlation id, or NULL
+	MqReplyTo *rt;		// v5 response topic, or NULL
+	int regno;
+	guchar val;		// value written
+	const char *status;	// from the write: ok, nack, timeout or error
+	gint64 queue_us;	// write's wait in the send queue
+	gint64 bus_us;		// time on the wire, write plus read-back
+} OmsSetReq;
+
+static void
+oms_setreq_write_done(OmsMessage *msg, int err)
+{
+	OmsSetReq *req = msg->done_data;
+	gint64 now = g_get_monotonic_time();
+
+	switch(err) {
+	case KE_NOERROR:
+		req->status = (msg->rstatus & 0x0f) == OMMS_ACK ? "ok" : "error";
+		break;
+	case KE_NACK:
+		req->status = "nack";
+		break;
+	case KE_TIMEOUT:
+		req->status = "timeout";
+		break;
+	default:	// garbled reply, or an answer from the wrong address
+		req->status = "error";
+	}
+	if(msg->sendtime) {
+		req->queue_us = msg->sendtime - msg->qtime;
+		req->bus_us += now - msg->sendtime;
+	}
+}
 
-	printf("recieved mqtt message: %s %s", me, tstatname);
-	if(cmd)
-		printf(" cmd=%s", cmd);
-	if(regname)
-		printf(" reg=%s", regname);
-	printf("\n");
-	
-	OmsNode *nd = mqoms_find_node(g_omc, tstatname);
+// the read-back finished; publish the outcome on result/set:
+// {"id":"42","reg":"cool_set","status":"ok","queue_ms":3,"bus_ms":96,"value":"24.0"}
+// status is ok, mismatch (read back a different value), nack, timeout, error or cancelled;
+// value is what was read back, or null if it couldn't be.
+static void
+oms_setreq_read_done(OmsMessage *msg, int err)
+{
+	OmsSetReq *req = msg->done_data;
+	OmsNode *nd = req->nd;
+	OmsTopic topic = { NULL, 0, MQ_PUB_EVERY };
+	char dbuf[MQSTRSIZE];
+	int have = err == KE_NOERROR && (msg->rstatus & 0x0f) == OMMS_DATA;
+
+	if(msg->sendtime)
+		req->bus_us += g_get_monotonic_time() - msg->sendtime;
+	if(have && strcmp(req->status, "ok") == 0 && nd->reg_cache[req->regno].val != req->val)
+		req->status = "mismatch";
+
+	GString *doc = g_string_sized_new(128);
+	g_string_append(doc, "{");
+	if(req->id) {
+		g_string_append(doc, "\"id\":");
+		json_append_str(doc, req->id);
+		g_string_append_c(doc, ',');
+	}
+	g_string_append(doc, "\"reg\":");
+	json_append_str(doc, req->reg);
+	g_string_append_printf(doc, ",\"status\":\"%s\",\"queue_ms\":%ld,\"bus_ms\":%ld,\"value\":",
+			       req->status, (long)(req->queue_us / 1000), (long)(req->bus_us / 1000));
+	if(have) {
+		omcs_regval(dbuf, req->regno, nd->reg_cache[req->regno].val, nd->model);
+		g_string_append_printf(doc, "\"%s\"}", dbuf);
+	} else
+		g_string_append(doc, "null}");
+	if(req->rt)
+		mqtt_publish_reply(req->rt, doc->str, doc->len);
+	else {
+		oms_topic_build(&topic, nd, "result/set");
+		mqtt_publish_topic(&topic, doc->str, doc->len);
+		g_free(topic.s);
+	}
+	g_string_free(doc, TRUE);
+	mq_reply_to_free(req->rt);
+	g_free(req->reg);
+	g_free(req->id);
+	g_free(req);
+}
 
-	// if tstatname == "server"  // maybe maintenance or diagnostic commands for us here
-	if(nd) {
-		printf("  target node=%s addr=%d payload=%s\n", nd->name, nd->addr, payload);
-		if(strcmp(cmd, "getreg") == 0) {
-			oms_nd_get_reg_str(nd, regname);
+// a set command's message is being dropped with its node.  the read-back is always
+// the later of the two, so that's where the outcome is published and req freed.
+// snapshots and write jobs have cancel functions of their own.
+static void
+oms_setreq_cancel(OmsMessage *msg)
+{
+	OmsSetReq *req = msg->done_data;
 
-		} else if(strcmp(cmd, "set") == 0) {
-			oms_nd_set_reg_str(nd, regname, payload);
-		}
+	if(msg->done == oms_setreq_write_done)
+		req->status = "cancelled";
+	else if(msg->done == oms_setreq_read_done) {
+		req->status = "cancelled";
+		oms_setreq_read_done(msg, KE_CANCELLED);
 	}
 }
 
-
-// set a thermostat register to a new value
-// register name and new value are both strings to be looked up and converted
-// to register number and binary-byte value
+// set a register from a command, and publish the outcome on result/set once the
+// value has been written and read back.  id, if any, is echoed in the result.
+// if rt is given, the result goes to its response topic instead; rt is ours to free.
 void
-oms_nd_set_reg_str(OmsNode *nd, char *regname, char *valstr)
+oms_nd_set_reg_req(OmsNode *nd, char *regname, char *valstr, const char *id, MqReplyTo *rt)
 {
 	uint8_t sbuf[16];
 	struct omst_reg *regtab = om_model_table(nd->model);   // TODO avoid doing this twice, once here
 	int regno = oms_nd_lookup_reg_by_topic(nd, regname); 	// and again in here
 	if(g_verbose)
 		printf("nd_set_reg_str regno=0x%02x\n", regno);
+	if(regno < 0 || !regtab[regno].cvt_byte) {
+		OmsTopic topic = { NULL, 0, MQ_PUB_EVERY };
+		GString *doc = g_string_new("{");
+		if(id) {
+			g_string_append(doc, "\"id\":");
+			json_append_str(doc, id);
+			g_string_append_c(doc, ',');
+		}
+		g_string_append(doc, "\"reg\":");
+		json_append_str(doc, regname);
+		g_string_append(doc, ",\"status\":\"badrequest\"}");
+		if(rt)
+			mqtt_publish_reply(rt, doc->str, doc->len);
+		else {
+			oms_topic_build(&topic, nd, "result/set");
+			mqtt_publish_topic(&topic, doc->str, doc->len);
+			g_free(topic.s);
+		}
+		mq_reply_to_free(rt);
+		g_string_free(doc, TRUE);
+		return;
+	}
 	if(regno >= 0) {
 		uint8_t valbyte = regtab[regno].cvt_byte(valstr);
 
@@ -838,8 +1229,20 @@ oms_nd_set_reg_str(OmsNode *nd, char *regname, char *valstr)
 		}
 		sbuf[0] = regno;
 		sbuf[1] = valbyte;
-		oms_node_send_msg_setregs(nd, sbuf, 2);
-		oms_node_send_msg_readregs(nd, regno, 1);  // read it back, and maybe publish
+		OmsSetReq *req = g_new0(OmsSetReq, 1);
+		req->nd = nd;
+		req->reg = g_strdup(regname);
+		req->id = g_strdup(id);
+		req->rt = rt;
+		req->regno = regno;
+		req->val = valbyte;
+		req->status = "timeout";
+		OmsMessage *msg = oms_node_send_msg_setregs(nd, sbuf, 2);
+		msg->done = oms_setreq_write_done;
+		msg->done_data = req;
+		msg = oms_node_send_msg_readregs(nd, regno, 1);  // read it back, and maybe publish
+		msg->done = oms_setreq_read_done;
+		msg->done_data = req;
 	}
 }
 
@@ -876,3 +1279,28 @@ oms_nd_lookup_reg_by_topic(OmsNode *nd, char *regname)
 	} else
 		return -1;
 }
+
+// find a register by mqtt topic, by its name in the model table (case-insensitive),
+// or by number ("0x3b" or "59").
+// return -1 if not found.
+int
+oms_nd_lookup_reg(OmsNode *nd, char *key)
+{
+	struct omst_reg *regtab = om_model_table(nd->model);
+	int max_regs = om_model_table_size(nd->model);
+	char *ep;
+	int regno;
+
+	if(!regtab)
+		return -1;
+	if((regno = oms_nd_lookup_reg_by_topic(nd, key)) >= 0)
+		return regno;
+	for(int i = 0; i < max_regs; i++) {
+		if(strcasecmp(regtab[i].name, key) == 0)
+			return i;
+	}
+	regno = strtol(key, &ep, 0);
+	if(ep != key && *ep == 0 && regno >= 0 && regno < max_regs)
+		return regno;
+	return -1;
+}
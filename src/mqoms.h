@@ -40,6 +40,7 @@
 #define KE_BADADDR      6
 #define KE_WRONGCMD     7
 #define KE_EOF          8
+#define KE_CANCELLED    9	// dropped unsent, e.g. its node was removed
 /* other non-error events used for tracing */
 #define KF_DISPATCH     16
 
@@ -55,6 +56,33 @@
 
 typedef struct _OmsMessage OmsMessage;
 typedef struct _OmsNode OmsNode;
+typedef struct _OmsSnapshot OmsSnapshot;
+typedef struct _OmsWriteJob OmsWriteJob;
+typedef struct _OmsPubPolicy OmsPubPolicy;
+typedef struct _OmsStateDoc OmsStateDoc;
+typedef struct _OmsGroup OmsGroup;
+typedef struct _OmsRuntime OmsRuntime;
+typedef struct _OmsHist OmsHist;
+
+// an mqtt topic built ahead of time, so publishing needs no formatting
+typedef struct {
+	char *s;
+	int len;
+	int flags;	// MQ_PUB_*
+} OmsTopic;
+
+#define MQ_PUB_PRIO	1	// state: kept longest in the outbox, and sent first
+#define MQ_PUB_RETAIN	2	// publish retained
+#define MQ_PUB_ALIAS	4	// worth a topic alias (v5)
+#define MQ_PUB_TELEMETRY 8	// a reading: expires, and carries its timestamp (v5)
+#define MQ_PUB_EVERY	16	// every message counts (results, raw frames): never coalesced in the outbox
+
+// where a v5 command asked for its result to go
+typedef struct {
+	char *topic;
+	void *corr;		// correlation data, or NULL
+	int corrlen;
+} MqReplyTo;
 
 // structure for omnistat communication channel - aka one serial port
 struct _OmsChan {
@@ -80,6 +108,11 @@ struct _OmsChan {
 
 	// per-thermostat structures.  max 127 on a wire, so just an array.
 	OmsNode *nodes[128];
+	GPtrArray *nodelist;	// the configured ones, densely packed, for sweeps
+
+	gint64 bus_us_avg;	// average time a transaction holds the bus, microseconds
+	guint boost_tag;	// boosted polling timer, see oms_poll.c; 0 if none
+	int boost_next;		// nodelist index to start the next boosted round at
 };
 typedef struct _OmsChan OmsChan;
 
@@ -89,8 +122,8 @@ struct _OmsMessage {
         guint flags;
 	guint id;
 
-        time_t qtime;   // todo higher resolution
-        time_t sendtime;
+        gint64 qtime;		// g_get_monotonic_time() when queued
+        gint64 sendtime;	// ... and when put on the wire
 
 	guchar nodeno;  	// thermostat address
         guint slength;             // packet length to send, minimum 1
@@ -101,11 +134,17 @@ struct _OmsMessage {
         guchar rbuf[OMNS_PKT_MAX];   // space for the reply
 
 	int serial;  /* message serial number */
+
+	// called once the message is finished with, after the reply or timeout has
+	// been handled, with err=KE_NOERROR on success.  msg is freed afterwards.
+	void (*done)(OmsMessage *msg, int err);
+	gpointer done_data;
 };
 typedef struct _OmsMessage OmsMessage;
 
 enum omsRegValFlags {
-	PUB_NEXT = 1
+	PUB_NEXT = 1,
+	READ_PENDING = 2	// read queued by oms_nd_read_static, reply not yet seen
 };
 
 // data about each register in the thermostat
@@ -113,6 +152,8 @@ struct _OmsRegVal {
 	time_t vtime;		// time last value recieved
 	uint8_t  val; 		// raw value
 	enum omsRegValFlags  flags;  // PUB_NEXT, etc.
+	uint8_t pubval;		// last value published
+	time_t pubtime;		// when, or 0 if not since the node came alive
 };
 typedef struct _OmsRegVal OmsRegVal;
 
@@ -136,14 +177,108 @@ struct _OmsNode {
 	int fanmode;
 	int hold;
 	time_t last_resp;
+	time_t boost_until;	// polled faster until then, see oms_poll.c
+	guchar sentinel[6];	// last sentinel reply, for sentinel polling
+	int sentinel_len;	// 0 until there is one
 
 	OmsRegVal reg_cache[256];
+
+	// publish topics, see oms_topic.c
+	OmsTopic t_state;
+	OmsTopic t_current;
+	OmsTopic t_snapshot;
+	OmsTopic t_doc;
+	OmsTopic t_bin;
+	OmsTopic t_runtime;
+	OmsTopic *t_reg;	// [256] by register, for the model in t_reg_model; NULL until it's known
+	int t_reg_model;
+	const OmsPubPolicy **pub_pol;	// [256] alongside t_reg; NULL entries aren't published
+
+	OmsSnapshot *snap;	// snapshot in progress, or NULL
+	OmsWriteJob *wjob;	// multi-register write in progress, or NULL
+	OmsStateDoc *doc;	// state document bookkeeping, see oms_doc.c
+	OmsRuntime *runtime;	// output runtime accounting, see oms_runtime.c
+	OmsHist *hist;		// recent history of selected registers, see oms_hist.c
+	int store_id;		// index in the history store segment's name table, see oms_store.c
+	guint store_gen;	// which segment store_id is for
 };
 
 
 extern int mqtt_setup();
 extern void mqtt_shutdown();
+extern gboolean mqtt_is_connected();
+extern int mqtt_send(const char *topic, const void *payload, int len, int flags, time_t ts);
+extern gboolean mqtt_send_retry(const char *topic, int rc);
+extern void mqtt_publish_reply(const MqReplyTo *rt, const char *payload, int len);
+extern void mqtt_load_config(GKeyFile *kf);
+extern int mqtt_retain_flags();
+extern void mqtt_set_will(const char *topic, const char *payload);
+extern int mqtt_send_now(const char *topic, const void *payload, int len, int flags, time_t ts);
+extern void mqtt_publish_reply_now(const MqReplyTo *rt, const char *payload, int len);
+extern void mqtt_alias_reset(int alias_max);
+extern void mqtt_connected_main(int rc, int alias_max);
+extern void mqtt_disconnected_main();
+
+extern int mq_thread_start();
+extern void mq_thread_stop();
+extern void mq_thread_publish(const char *topic, const void *payload, int len, int flags, time_t ts);
+extern void mq_thread_reply(const MqReplyTo *rt, const char *payload, int len);
+extern void mq_thread_reset_aliases(int alias_max);
+extern void mq_thread_post_message(const char *topic, const void *payload, int len, const MqReplyTo *rt);
+extern void mq_thread_post_connect(int rc, int alias_max);
+extern void mq_thread_post_disconnect();
+
+extern void mq_outbox_load_config(GKeyFile *kf);
+extern void mq_outbox_put(const char *topic, const void *payload, int len, int flags, time_t ts);
+extern gboolean mq_outbox_holds(const char *topic);
+extern int mq_outbox_pending();
+extern void mq_outbox_drain();
+extern void mq_outbox_flush();
+extern void publish_hello();
 extern void mqtt_publish(char *topic, char *msg);
+extern void mqtt_publish_topic(const OmsTopic *t, const char *msg, int len);
+
+extern int oms_topic_set_format(const char *fmt);
+extern void oms_topic_build(OmsTopic *t, OmsNode *nd, const char *sub);
+extern void oms_nd_topics_init(OmsNode *nd);
+extern void oms_nd_topics_model(OmsNode *nd);
+extern void oms_nd_topics_free(OmsNode *nd);
+
+struct omst_reg;
+extern void oms_pub_policy_load(GKeyFile *kf);
+extern const OmsPubPolicy *oms_pub_policy_for(struct omst_reg *reg);
+extern int oms_nd_pub_filter(OmsNode *nd, guint regaddr, guchar val);
+extern void oms_nd_pub_reset(OmsNode *nd);
+extern void oms_nd_republish(OmsNode *nd);
+
+extern void oms_doc_load_config(GKeyFile *kf);
+extern void oms_nd_doc_update(OmsNode *nd);
+extern void oms_nd_doc_update_grp1(OmsNode *nd, const guchar *vals);
+extern void oms_nd_doc_full(OmsNode *nd);
+extern gboolean oms_doc_only();
+extern void oms_nd_doc_free(OmsNode *nd);
+
+extern void oms_runtime_load_config(GKeyFile *kf);
+extern void oms_runtime_init();
+extern void oms_nd_runtime_sample(OmsNode *nd, guchar val);
+extern void oms_nd_runtime_free(OmsNode *nd);
+
+extern void oms_hist_load_config(GKeyFile *kf);
+extern void oms_nd_hist_sample(OmsNode *nd, guint regaddr, guchar val);
+extern void oms_nd_hist_free(OmsNode *nd);
+extern void oms_nd_history_query(OmsNode *nd, const char *payload, int len, MqReplyTo *rt);
+
+extern void oms_store_load_config(GKeyFile *kf);
+extern void oms_nd_store_sample(OmsNode *nd, guint regaddr, guchar val);
+extern void oms_store_close();
+
+extern void oms_warm_load_config(GKeyFile *kf);
+extern void oms_warm_restore();
+extern void oms_warm_save(gboolean sync);
+extern void oms_warm_init();
+
+extern void oms_bin_load_config(GKeyFile *kf);
+extern void oms_nd_bin_publish(OmsNode *nd, guint startreg, const guchar *vals, int n);
 
 OmsChan *oms_chan_open(char *fname);
 void oms_chan_close(OmsChan *omc);
@@ -151,6 +286,10 @@ void oms_chan_recv(OmsChan *omc); // called when select() says there's somthing
 void oms_chan_dispatch(OmsChan *omc);
 extern void oms_chan_print(OmsChan *omc);
 OmsNode *oms_chan_add_node(OmsChan *omc,  guint node, char *name);
+extern void oms_chan_remove_node(OmsChan *omc, OmsNode *nd);
+extern OmsNode *oms_node_lookup(const char *name, int len);
+extern const char *oms_node_name_check(const char *name);
+extern GPtrArray *oms_chans;
 extern void oms_chan_dump_nodes(OmsChan *omc);
 void oms_chan_timeout_handler(OmsChan *omc, OmsMessage *msg, int err);
 void oms_chan_reply_handler(OmsChan *omc, OmsMessage *msg, int error);
@@ -159,13 +298,56 @@ extern void oms_chan_reply_regdata(OmsNode *nd, OmsMessage *msg);
 extern void oms_nd_regdata(OmsNode *nd, guint regaddr, guchar val);
 extern void oms_nd_update_state(OmsNode *nd);
 void oms_msg_print(OmsMessage *msg, char *str);
+OmsMessage *oms_chan_send_msg(OmsChan *omc, int addr, int scmd, unsigned char *sbuf, int sblen);
+extern OmsMessage *oms_node_send_msg_readregs(OmsNode *nd, int startreg, unsigned int count);
+extern OmsMessage *oms_node_send_msg_setregs(OmsNode *nd, unsigned char *sbuf, unsigned int count);
+extern int oms_plan_reads(const guchar *want, int nregs, int *starts, int *counts, int maxreads);
 void per_minute_init();
-extern void mq_recv_message(char *topic, char *payload	);
+extern void mq_recv_message(const char *topic, const void *payload, int len, const MqReplyTo *rt);
+extern MqReplyTo *mq_dispatch_reply_to();
+extern void mq_reply_to_free(MqReplyTo *rt);
+extern char **mq_dispatch_subscriptions();
+
+extern int oms_nd_reg_flags(OmsNode *nd, guint regaddr);
+extern int oms_nd_reg_fresh(OmsNode *nd, guint regaddr);
+extern void oms_nd_invalidate_static(OmsNode *nd);
+extern void oms_nd_read_static(OmsNode *nd);
 
 extern int oms_nd_lookup_reg_by_topic(OmsNode *nd, char *regname);
+extern int oms_nd_lookup_reg(OmsNode *nd, char *key);
 extern void oms_nd_set_reg_str(OmsNode *nd, char *regname, char *valstr);
+extern void oms_nd_set_reg_req(OmsNode *nd, char *regname, char *valstr, const char *id, MqReplyTo *rt);
 extern void oms_nd_get_reg_str(OmsNode *nd, char *regname);
 extern void oms_list_goodbye();
+extern void oms_list_broker_connected();
+extern void oms_nd_snapshot(OmsNode *nd);
+extern void oms_nd_snapshot_cancel(OmsNode *nd);
+extern void oms_nd_getmany(OmsNode *nd, const char *payload, int len);
+extern void oms_nd_setmany(OmsNode *nd, const char *payload, int len);
+
+extern OmsWriteJob *oms_wjob_new(OmsNode *nd, const char *cmd);
+extern int oms_wjob_set_str(OmsWriteJob *job, char *key, char *valstr, int reqflags);
+extern void oms_wjob_start(OmsWriteJob *job);
+extern void oms_wjob_cancel(OmsNode *nd);
+extern void oms_wjob_set_done(OmsWriteJob *job, void (*fn)(OmsWriteJob *job, const char *status, gpointer data), gpointer data);
+extern OmsNode *oms_wjob_node(OmsWriteJob *job);
+extern void oms_wjob_set_bad(OmsWriteJob *job);
+
+extern void oms_poll_load_config(GKeyFile *kf);
+extern void oms_nd_boost(OmsNode *nd, int secs);
+extern void oms_chan_boost_stop(OmsChan *omc);
+extern gboolean oms_poll_swept(OmsNode *nd);
+extern int oms_poll_alive_age();
+extern void oms_poll_init();
+
+extern void oms_group_load_config(GKeyFile *kf);
+extern OmsGroup *oms_group_lookup(const char *name, int len);
+extern void oms_group_set(OmsGroup *grp, char *regname, char *valstr, const char *id, MqReplyTo *rt);
+extern OmsWriteJob *oms_nd_txn_begin(OmsNode *nd, const char *cmd);
+extern int oms_nd_txn_set(OmsWriteJob *txn, char *regname, char *valstr);
+extern void oms_nd_txn_commit(OmsWriteJob *txn);
+extern void oms_nd_txn_str(OmsNode *nd, const char *payload, int len);
+extern void oms_nd_set_config(OmsNode *nd, const char *payload, int len);
 
 #define MQSTRSIZE 128
 
@@ -88,7 +88,9 @@ enum omreg_flags {RESV=0,       /* reserved register */
                   SV=4,         /* OK to save/restore as group */
                   OKG=3|4,       /* SV|OK */
 		  PUBA=8,	/* always publish when recieved */
-		  PUBC=16	/* publish when recieved only if changed */
+		  PUBC=16,	/* publish when recieved only if changed */
+		  STC=32,	/* static: never changes while powered; read once per node life cycle */
+		  SLW=64	/* slowly changing config/schedule data.  neither STC nor SLW means volatile */
 };      
 
 struct omst_reg {
@@ -115,6 +117,7 @@ extern void omcs_regval(char *str, unsigned char regaddr, unsigned char val, uns
 
 // some omnistat register addresses known to our code
 
+#define OM_REGADDR_ADDRESS	0x00
 #define OM_REGADDR_MODEL	0x49
 #define OM_REGADDR_COOL_SETPT	0x3B
 
@@ -0,0 +1,57 @@
+/*
+ * compact binary register publishing.
+ *
+ * With binary=true in [server], every batch of register data read from a
+ * thermostat is also published, unconverted, on omnistat/<node>/bin/regs
+ * (following topic_format).  One message per reply, fixed layout, all
+ * multi-byte fields big-endian:
+ *
+ *	offset	size
+ *	0	1	layout version, currently 1
+ *	1	1	thermostat bus address
+ *	2	1	model code (register 0x49), 0 if not yet known
+ *	3	1	first register
+ *	4	1	n, number of registers
+ *	5	8	time the reply arrived, milliseconds since the unix epoch
+ *	13	n	raw register bytes, first register first
+ *
+ * Values are the thermostat's own encodings: temperatures in its Omni
+ * temperature units, output status (0x48) as its bitfield, and so on; see
+ * the register tables in omnistat.c.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <mqoms.h>
+
+#define OMS_BIN_VERSION	1
+#define OMS_BIN_HDRLEN	13
+
+int oms_bin_enabled;
+
+void
+oms_bin_load_config(GKeyFile *kf)
+{
+	oms_bin_enabled = g_key_file_get_boolean(kf, "server", "binary", NULL);
+}
+
+// publish n register values starting at startreg
+void
+oms_nd_bin_publish(OmsNode *nd, guint startreg, const guchar *vals, int n)
+{
+	guchar buf[OMS_BIN_HDRLEN + 256];
+	guint64 ms = g_get_real_time() / 1000;
+
+	if(!oms_bin_enabled || n <= 0 || n > 256)
+		return;
+	buf[0] = OMS_BIN_VERSION;
+	buf[1] = nd->addr;
+	buf[2] = nd->model;
+	buf[3] = startreg;
+	buf[4] = n;
+	for(int i = 0; i < 8; i++)
+		buf[5+i] = ms >> (56 - 8*i);
+	memcpy(buf + OMS_BIN_HDRLEN, vals, n);
+	mqtt_publish_topic(&nd->t_bin, (const char *)buf, OMS_BIN_HDRLEN + n);
+}
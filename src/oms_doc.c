@@ -0,0 +1,166 @@
+/*
+ * per-node state document.
+ *
+ * Optionally publishes everything a node publishes as separate topics in one
+ * JSON document on omnistat/<node>/doc, built from reg_cache after each reply:
+ *
+ *	{"seq":12,"time":1700000060,"full":false,"state":"alive",
+ *	 "fields":{"current":{"v":"22.5","t":1700000059},"outstatus":{"v":"heat|run","t":1700000059}}}
+ *
+ * seq counts documents for the node, so a consumer can tell it missed one.
+ * In delta mode a document carries only the fields that changed since the
+ * previous one, and a full document goes out every state_doc_full seconds;
+ * a consumer that missed a delta just waits for the next full document.
+ *
+ * After a group 1 (OMMT_GETG) reply, the document carries the six registers
+ * it returned, timed at the reply.
+ *
+ * With state_doc_only=true the document replaces the per-register topics:
+ * one message per poll instead of one per changed value.  state, and the
+ * snapshot, result and bin topics, are still published as before.
+ *
+ * [server] settings:
+ *	state_doc=off|full|delta	(default off)
+ *	state_doc_full=<secs>		(default 300, delta mode only)
+ *	state_doc_only=true|false	(default false)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+
+enum { DOC_OFF, DOC_FULL, DOC_DELTA };
+
+static int oms_doc_mode = DOC_OFF;
+static int oms_doc_full_interval = 300;
+static gboolean oms_doc_only_on;
+
+struct _OmsStateDoc {
+	guint seq;
+	time_t last_full;
+	int last_state;
+	guchar sent[256];	// field has been in a document since the last full one
+	guchar val[256];	// value as last sent
+};
+
+void
+oms_doc_load_config(GKeyFile *kf)
+{
+	char *mode = g_key_file_get_string(kf, "server", "state_doc", NULL);
+	if(mode) {
+		if(strcmp(mode, "full") == 0)
+			oms_doc_mode = DOC_FULL;
+		else if(strcmp(mode, "delta") == 0)
+			oms_doc_mode = DOC_DELTA;
+		else if(strcmp(mode, "off") != 0)
+			fprintf(stderr, "state_doc: unknown mode %s\n", mode);
+		g_free(mode);
+	}
+	if(g_key_file_has_key(kf, "server", "state_doc_full", NULL)) {
+		oms_doc_full_interval = g_key_file_get_integer(kf, "server", "state_doc_full", NULL);
+		if(oms_doc_full_interval < 1)
+			oms_doc_full_interval = 300;
+	}
+	oms_doc_only_on = g_key_file_get_boolean(kf, "server", "state_doc_only", NULL);
+}
+
+// are per-register topics left out in favour of the document?
+gboolean
+oms_doc_only()
+{
+	return oms_doc_mode != DOC_OFF && oms_doc_only_on;
+}
+
+static const char *
+oms_doc_state_str(int state)
+{
+	switch(state) {
+	case NODE_ALIVE:
+		return "alive";
+	case NODE_WAKEUP:
+		return "wakeup";
+	default:
+		return "dead";
+	}
+}
+
+// publish a document if anything went into it.  values for the n registers from
+// ovstart are taken from ov[] as read just now, rather than from reg_cache.
+static void
+oms_nd_doc_build(OmsNode *nd, int ovstart, const guchar *ov, int n)
+{
+	char dbuf[MQSTRSIZE];
+	struct omst_reg *regtab = om_model_table(nd->model);
+	time_t now = time(NULL);
+	int nfields = 0;
+
+	if(oms_doc_mode == DOC_OFF || !regtab || !nd->pub_pol || nd->t_reg_model != nd->model)
+		return;
+	if(!nd->doc)
+		nd->doc = g_new0(OmsStateDoc, 1);
+	OmsStateDoc *doc = nd->doc;
+
+	int full = oms_doc_mode == DOC_FULL || now - doc->last_full >= oms_doc_full_interval;
+
+	GString *s = g_string_sized_new(512);
+	g_string_append_printf(s, "{\"seq\":%u,\"time\":%ld,\"full\":%s,\"state\":\"%s\",\"fields\":{",
+			       doc->seq, (long)now, full ? "true" : "false", oms_doc_state_str(nd->state));
+	for(int r = 0; r < 256; r++) {
+		int over = ov && r >= ovstart && r < ovstart + n;
+		guchar val = over ? ov[r - ovstart] : nd->reg_cache[r].val;
+		time_t vtime = over ? now : nd->reg_cache[r].vtime;
+		if(!nd->pub_pol[r] || !vtime)
+			continue;
+		if(!full && doc->sent[r] && doc->val[r] == val)
+			continue;
+		omcs_regval(dbuf, r, val, nd->model);
+		g_string_append_printf(s, "%s\"%s\":{\"v\":\"%s\",\"t\":%ld}",
+				       nfields ? "," : "", regtab[r].topic, dbuf, (long)vtime);
+		doc->sent[r] = 1;
+		doc->val[r] = val;
+		nfields++;
+	}
+	g_string_append(s, "}}");
+
+	if(nfields || full || nd->state != doc->last_state) {
+		mqtt_publish_topic(&nd->t_doc, s->str, s->len);
+		doc->seq++;
+		if(full)
+			doc->last_full = now;
+		doc->last_state = nd->state;
+	}
+	g_string_free(s, TRUE);
+}
+
+// call after each batch of register data, and on state changes.
+void
+oms_nd_doc_update(OmsNode *nd)
+{
+	oms_nd_doc_build(nd, 0, NULL, 0);
+}
+
+// after a group 1 reply: registers 0x3B-0x40, in vals[6]
+void
+oms_nd_doc_update_grp1(OmsNode *nd, const guchar *vals)
+{
+	oms_nd_doc_build(nd, OM_REGADDR_STATUS, vals, 6);
+}
+
+// send a full document at the next update, e.g. to a new broker connection
+void
+oms_nd_doc_full(OmsNode *nd)
+{
+	if(nd->doc)
+		nd->doc->last_full = 0;
+	oms_nd_doc_update(nd);
+}
+
+void
+oms_nd_doc_free(OmsNode *nd)
+{
+	g_free(nd->doc);
+	nd->doc = NULL;
+}
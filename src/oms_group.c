@@ -0,0 +1,346 @@
+/*
+ * node groups: one command for several thermostats.
+ *
+ * Groups are listed in a [groups] section of the .ini file, one per key:
+ *
+ *	[groups]
+ *	upstairs=bed1;bed2;bath
+ *
+ * and addressed as omnistat/group/<group>/set/<register>[/<id>], payload the
+ * value, just like a set on a single node.  Each member gets a write job
+ * (result/group on the node), and the group gets one summary when all of them
+ * are finished, on omnistat/group/<group>/result/set:
+ *
+ *	{"id":"7","reg":"heat_set","status":"partial","ok":2,"failed":1,"ms":2140,
+ *	 "results":{"bed1":"ok","bed2":"unchanged","bath":"busy"},"missing":[]}
+ *
+ * status is ok if every member was set (or already had the value), failed if
+ * none were, and partial otherwise.  missing lists members not configured.
+ *
+ * Members are taken round-robin across the serial channels they are on, so
+ * every bus works on the group at once, and paced per bus: at most
+ * group_per_chan members of a group in progress on one channel, and none
+ * started while that channel's send queue is longer than group_queue_max
+ * (both [server] settings, defaults 2 and 8), so polling and other commands
+ * keep moving.  One command per group runs at a time; another is answered busy.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+#include <utils.h>
+
+#define GROUP_PER_CHAN_DEFAULT	2
+#define GROUP_QUEUE_MAX_DEFAULT	8
+#define GROUP_PACE		100	// milliseconds between looks at a busy channel
+
+typedef struct _OmsGroupJob OmsGroupJob;
+
+struct _OmsGroup {
+	char *name;
+	char **members;		// node names, looked up when the command runs
+	OmsGroupJob *job;	// command in progress, or NULL
+};
+
+// one channel's share of a group command
+typedef struct {
+	OmsGroupJob *gj;
+	OmsChan *omc;
+	GQueue pending;		// member names not started yet
+	int running;
+} OmsGroupLane;
+
+struct _OmsGroupJob {
+	OmsGroup *grp;
+	char *reg;
+	char *val;
+	char *id;
+	MqReplyTo *rt;
+	gint64 start;
+
+	GPtrArray *lanes;	// OmsGroupLane, one per channel with members
+	int running;
+	int pumping;		// starting members; completions wait for us
+	guint pace_tag;
+
+	int nok;		// set, or already had the value
+	int nfailed;
+	GString *results;	// "node":"status",... for the summary
+	GString *missing;
+};
+
+static GHashTable *oms_groups;	// OmsGroupKey -> OmsGroup
+static int group_per_chan = GROUP_PER_CHAN_DEFAULT;
+static int group_queue_max = GROUP_QUEUE_MAX_DEFAULT;
+
+typedef struct {
+	const char *s;
+	int len;
+} OmsGroupKey;
+
+static guint
+oms_group_key_hash(gconstpointer p)
+{
+	const OmsGroupKey *k = p;
+	guint h = 5381;
+	for(int i = 0; i < k->len; i++)
+		h = h * 33 + (guchar)k->s[i];
+	return h;
+}
+
+static gboolean
+oms_group_key_equal(gconstpointer a, gconstpointer b)
+{
+	const OmsGroupKey *ka = a, *kb = b;
+	return ka->len == kb->len && memcmp(ka->s, kb->s, ka->len) == 0;
+}
+
+// read [groups], and the pacing settings in [server]
+void
+oms_group_load_config(GKeyFile *kf)
+{
+	gsize nkeys;
+	gchar **keys;
+
+	if(g_key_file_has_key(kf, "server", "group_per_chan", NULL))
+		group_per_chan = MAX(1, g_key_file_get_integer(kf, "server", "group_per_chan", NULL));
+	if(g_key_file_has_key(kf, "server", "group_queue_max", NULL))
+		group_queue_max = MAX(1, g_key_file_get_integer(kf, "server", "group_queue_max", NULL));
+
+	if(!(keys = g_key_file_get_keys(kf, "groups", &nkeys, NULL)))
+		return;
+	if(!oms_groups)
+		oms_groups = g_hash_table_new(oms_group_key_hash, oms_group_key_equal);
+	for(int i = 0; i < nkeys; i++) {
+		OmsGroup *grp;
+		OmsGroupKey *key;
+		if(strpbrk(keys[i], "/+#")) {
+			fprintf(stderr, "[groups]: %s can't be used in a topic\n", keys[i]);
+			continue;
+		}
+		grp = g_new0(OmsGroup, 1);
+		grp->name = g_strdup(keys[i]);
+		grp->members = g_key_file_get_string_list(kf, "groups", keys[i], NULL, NULL);
+		key = g_new0(OmsGroupKey, 1);
+		key->s = grp->name;
+		key->len = strlen(grp->name);
+		g_hash_table_replace(oms_groups, key, grp);
+	}
+	g_strfreev(keys);
+}
+
+// find a group by name; name need not be NUL-terminated
+OmsGroup *
+oms_group_lookup(const char *name, int len)
+{
+	OmsGroupKey key = { name, len };
+	return oms_groups ? g_hash_table_lookup(oms_groups, &key) : NULL;
+}
+
+static OmsGroupLane *
+oms_gjob_lane(OmsGroupJob *gj, OmsChan *omc)
+{
+	OmsGroupLane *lane;
+	for(int i = 0; i < gj->lanes->len; i++) {
+		lane = g_ptr_array_index(gj->lanes, i);
+		if(lane->omc == omc)
+			return lane;
+	}
+	lane = g_new0(OmsGroupLane, 1);
+	lane->gj = gj;
+	lane->omc = omc;
+	g_queue_init(&lane->pending);
+	g_ptr_array_add(gj->lanes, lane);
+	return lane;
+}
+
+static void
+oms_gjob_result(OmsGroupJob *gj, const char *node, const char *status)
+{
+	if(gj->results->len)
+		g_string_append_c(gj->results, ',');
+	json_append_str(gj->results, node);
+	g_string_append_printf(gj->results, ":\"%s\"", status);
+	if(strcmp(status, "ok") == 0 || strcmp(status, "unchanged") == 0)
+		gj->nok++;
+	else
+		gj->nfailed++;
+}
+
+static void
+oms_gjob_missing(OmsGroupJob *gj, const char *node)
+{
+	if(gj->missing->len)
+		g_string_append_c(gj->missing, ',');
+	json_append_str(gj->missing, node);
+}
+
+// {"id":...,"reg":...,<body>}; id and reg come from the command topic
+static void
+oms_group_publish(OmsGroup *grp, const char *id, const MqReplyTo *rt, const char *reg, const char *body)
+{
+	GString *doc = g_string_sized_new(256);
+	g_string_append(doc, "{");
+	if(id) {
+		g_string_append(doc, "\"id\":");
+		json_append_str(doc, id);
+		g_string_append_c(doc, ',');
+	}
+	g_string_append(doc, "\"reg\":");
+	json_append_str(doc, reg);
+	g_string_append_printf(doc, ",%s}", body);
+	if(rt)
+		mqtt_publish_reply(rt, doc->str, doc->len);
+	else {
+		OmsTopic topic = { NULL, 0, MQ_PUB_EVERY };
+		topic.s = g_strdup_printf("omnistat/group/%s/result/set", grp->name);
+		topic.len = strlen(topic.s);
+		mqtt_publish_topic(&topic, doc->str, doc->len);
+		g_free(topic.s);
+	}
+	g_string_free(doc, TRUE);
+}
+
+static void
+oms_gjob_finish(OmsGroupJob *gj)
+{
+	const char *status = gj->nfailed == 0 && gj->missing->len == 0 ? "ok" : gj->nok ? "partial" : "failed";
+	char *body = g_strdup_printf("\"status\":\"%s\",\"ok\":%d,\"failed\":%d,\"ms\":%ld,"
+				     "\"results\":{%s},\"missing\":[%s]",
+				     status, gj->nok, gj->nfailed,
+				     (long)((g_get_monotonic_time() - gj->start) / 1000),
+				     gj->results->str, gj->missing->str);
+	oms_group_publish(gj->grp, gj->id, gj->rt, gj->reg, body);
+	g_free(body);
+
+	if(gj->pace_tag)
+		g_source_remove(gj->pace_tag);
+	for(int i = 0; i < gj->lanes->len; i++) {
+		OmsGroupLane *lane = g_ptr_array_index(gj->lanes, i);
+		g_queue_clear(&lane->pending);
+		g_free(lane);
+	}
+	g_ptr_array_free(gj->lanes, TRUE);
+	gj->grp->job = NULL;
+	g_string_free(gj->results, TRUE);
+	g_string_free(gj->missing, TRUE);
+	mq_reply_to_free(gj->rt);
+	g_free(gj->reg);
+	g_free(gj->val);
+	g_free(gj->id);
+	g_free(gj);
+}
+
+static void oms_gjob_pump(OmsGroupJob *gj);
+
+static void
+oms_gjob_member_done(OmsWriteJob *job, const char *status, gpointer data)
+{
+	OmsGroupLane *lane = data;
+	OmsGroupJob *gj = lane->gj;
+
+	oms_gjob_result(gj, oms_wjob_node(job)->name, status);
+	lane->running--;
+	gj->running--;
+	if(!gj->pumping)
+		oms_gjob_pump(gj);
+}
+
+static gboolean
+oms_gjob_pace(gpointer data)
+{
+	OmsGroupJob *gj = data;
+	gj->pace_tag = 0;
+	oms_gjob_pump(gj);
+	return G_SOURCE_REMOVE;
+}
+
+// start the next member on a lane, if its channel has room for it.
+// returns FALSE if it didn't.
+static gboolean
+oms_gjob_start_one(OmsGroupLane *lane, gboolean *blocked)
+{
+	OmsGroupJob *gj = lane->gj;
+	char *name;
+	OmsNode *nd;
+
+	if(g_queue_is_empty(&lane->pending) || lane->running >= group_per_chan)
+		return FALSE;
+	if(g_list_length(lane->omc->sendq) >= group_queue_max) {
+		*blocked = TRUE;
+		return FALSE;
+	}
+	name = g_queue_pop_head(&lane->pending);
+	if(!(nd = oms_node_lookup(name, strlen(name)))) {
+		oms_gjob_missing(gj, name);	// removed since the command arrived
+		return TRUE;
+	}
+	OmsWriteJob *job = oms_wjob_new(nd, "group");
+	if(!om_model_table(nd->model) || oms_wjob_set_str(job, gj->reg, gj->val, WOK) < 0)
+		oms_wjob_set_bad(job);
+	oms_wjob_set_done(job, oms_gjob_member_done, lane);
+	lane->running++;
+	gj->running++;
+	oms_wjob_start(job);
+	return TRUE;
+}
+
+// start what the channels have room for, one member per channel per round
+static void
+oms_gjob_pump(OmsGroupJob *gj)
+{
+	gboolean started, blocked = FALSE, pending = FALSE;
+
+	gj->pumping = 1;
+	do {
+		started = FALSE;
+		for(int i = 0; i < gj->lanes->len; i++)
+			started |= oms_gjob_start_one(g_ptr_array_index(gj->lanes, i), &blocked);
+	} while(started);
+	gj->pumping = 0;
+
+	for(int i = 0; i < gj->lanes->len; i++) {
+		OmsGroupLane *lane = g_ptr_array_index(gj->lanes, i);
+		pending |= !g_queue_is_empty(&lane->pending);
+	}
+	if(!pending && gj->running == 0)
+		oms_gjob_finish(gj);
+	else if(blocked && !gj->pace_tag)
+		gj->pace_tag = g_timeout_add(GROUP_PACE, oms_gjob_pace, gj);
+}
+
+// mqtt: omnistat/group/<group>/set/<register>[/<id>], payload the value.
+// rt, if any, is ours to free.
+void
+oms_group_set(OmsGroup *grp, char *regname, char *valstr, const char *id, MqReplyTo *rt)
+{
+	OmsGroupJob *gj;
+
+	if(grp->job) {
+		oms_group_publish(grp, id, rt, regname, "\"status\":\"busy\"");
+		mq_reply_to_free(rt);
+		return;
+	}
+	gj = g_new0(OmsGroupJob, 1);
+	gj->grp = grp;
+	gj->reg = g_strdup(regname);
+	gj->val = g_strdup(valstr);
+	gj->id = g_strdup(id);
+	gj->rt = rt;
+	gj->start = g_get_monotonic_time();
+	gj->lanes = g_ptr_array_new();
+	gj->results = g_string_new(NULL);
+	gj->missing = g_string_new(NULL);
+	grp->job = gj;
+
+	for(char **m = grp->members; m && *m; m++) {
+		OmsNode *nd = oms_node_lookup(*m, strlen(*m));
+		if(nd)
+			g_queue_push_tail(&oms_gjob_lane(gj, nd->omc)->pending, *m);
+		else
+			oms_gjob_missing(gj, *m);
+	}
+	oms_gjob_pump(gj);
+}
@@ -0,0 +1,359 @@
+/*
+ * recent history of selected registers, kept in fixed memory per node.
+ *
+ * The registers named by topic in history= in [server] (e.g.
+ * history=current;outstatus;heat_set) are recorded at three resolutions:
+ *
+ *	raw	every reading for the last hour (up to HIST_RAW_N of them),
+ *		as time and value deltas from the reading before
+ *	1m	one-minute means for a day
+ *	15m	15-minute means for a month
+ *
+ * The mean tiers are rings of fixed slots, so their times are implicit; a
+ * slot holds 16 times the mean raw register value, or HIST_EMPTY.  About 13k
+ * per register per node, allocated on the first reading.
+ *
+ * Query with omnistat/<node>/history, payload reg=<topic>;from=<unix>;to=<unix>;tier=raw|1m|15m
+ * (or as JSON).  from defaults to an hour ago, to to now, and tier to the
+ * finest one that reaches back to from.  The answer, on result/history or the
+ * v5 response topic:
+ *
+ *	{"reg":"current","tier":"1m","start":1700000040,"step":60,"values":[22.5,22.5,null,23.0]}
+ *	{"reg":"current","tier":"raw","start":1700000041,"t":[0,60,61],"values":[22.5,23.0,23.0]}
+ *
+ * For raw, t is seconds since the previous value.  Temperatures are in
+ * degrees C, other registers as raw numbers (means may be fractional).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+#include <utils.h>
+
+#define HIST_RAW_N	1024
+#define HIST_RAW_AGE	3600
+#define HIST_EMPTY	0xffff
+#define HIST_MAX_POINTS	1500	// per answer; longer ranges are cut at the old end
+
+typedef struct {
+	guint16 *slot;		// n means, times 16, by slot number modulo n
+	int n;
+	int step;		// seconds per slot
+	gint64 cur;		// slot number being accumulated, 0 before the first reading
+	int sum, cnt;
+} OmsHistTier;
+
+typedef struct {
+	int regno;
+	// raw: ring of (dt, dv) from the reading before; the oldest is (0,0) and
+	// its absolute time and value are base_t and base_v
+	guint16 dt[HIST_RAW_N];
+	gint16 dv[HIST_RAW_N];
+	int head, count;
+	time_t base_t, last_t;
+	int base_v, last_v;
+	OmsHistTier min1, min15;
+} OmsHistSeries;
+
+struct _OmsHist {
+	int model;		// regs[] resolved for this model
+	OmsHistSeries *regs[256];
+};
+
+static char **hist_topics;	// registers to record, by topic
+
+void
+oms_hist_load_config(GKeyFile *kf)
+{
+	hist_topics = g_key_file_get_string_list(kf, "server", "history", NULL, NULL);
+}
+
+static void
+hist_tier_init(OmsHistTier *t, int n, int step)
+{
+	t->slot = g_new(guint16, n);
+	for(int i = 0; i < n; i++)
+		t->slot[i] = HIST_EMPTY;
+	t->n = n;
+	t->step = step;
+}
+
+static void
+hist_tier_add(OmsHistTier *t, time_t now, int v)
+{
+	gint64 s = now / t->step;
+
+	if(s != t->cur) {
+		if(t->cur) {
+			t->slot[t->cur % t->n] = t->cnt ? t->sum * 16 / t->cnt : HIST_EMPTY;
+			for(gint64 e = t->cur + 1; e < s && e <= t->cur + t->n; e++)
+				t->slot[e % t->n] = HIST_EMPTY;		// no readings then
+		}
+		t->cur = s;
+		t->sum = t->cnt = 0;
+	}
+	t->sum += v;
+	t->cnt++;
+}
+
+// mean of slot s times 16, or HIST_EMPTY
+static int
+hist_tier_get(OmsHistTier *t, gint64 s)
+{
+	if(!t->cur || s > t->cur || s <= t->cur - t->n)
+		return HIST_EMPTY;
+	if(s == t->cur)
+		return t->cnt ? t->sum * 16 / t->cnt : HIST_EMPTY;
+	return t->slot[s % t->n];
+}
+
+// drop the oldest raw reading
+static void
+hist_raw_evict(OmsHistSeries *hs)
+{
+	if(hs->count > 1) {
+		int next = (hs->head + 1) % HIST_RAW_N;
+		hs->base_t += hs->dt[next];
+		hs->base_v += hs->dv[next];
+		hs->dt[next] = hs->dv[next] = 0;
+		hs->head = next;
+	}
+	hs->count--;
+}
+
+static void
+hist_raw_add(OmsHistSeries *hs, time_t now, int v)
+{
+	if(hs->count && now - hs->last_t > G_MAXUINT16)
+		hs->count = 0;		// too long ago to express as a delta; start again
+	while(hs->count && (hs->count == HIST_RAW_N || now - hs->base_t > HIST_RAW_AGE))
+		hist_raw_evict(hs);
+	int ix = (hs->head + hs->count) % HIST_RAW_N;
+	if(hs->count == 0) {
+		hs->head = ix;
+		hs->base_t = now;
+		hs->base_v = v;
+		hs->dt[ix] = hs->dv[ix] = 0;
+	} else {
+		hs->dt[ix] = now - hs->last_t;
+		hs->dv[ix] = v - hs->last_v;
+	}
+	hs->count++;
+	hs->last_t = now;
+	hs->last_v = v;
+}
+
+static OmsHistSeries *
+hist_series_new(int regno)
+{
+	OmsHistSeries *hs = g_new0(OmsHistSeries, 1);
+	hs->regno = regno;
+	hist_tier_init(&hs->min1, 24 * 60, 60);
+	hist_tier_init(&hs->min15, 30 * 24 * 4, 15 * 60);
+	return hs;
+}
+
+static void
+hist_series_free(OmsHistSeries *hs)
+{
+	g_free(hs->min1.slot);
+	g_free(hs->min15.slot);
+	g_free(hs);
+}
+
+// which registers to record depends on the model table
+static void
+oms_nd_hist_resolve(OmsNode *nd)
+{
+	OmsHist *h = nd->hist;
+	guchar want[256] = { 0 };
+
+	for(char **tp = hist_topics; *tp; tp++) {
+		int r = oms_nd_lookup_reg_by_topic(nd, *tp);
+		if(r >= 0)
+			want[r] = 1;
+	}
+	for(int r = 0; r < 256; r++) {
+		if(want[r] && !h->regs[r])
+			h->regs[r] = hist_series_new(r);
+		else if(!want[r] && h->regs[r]) {
+			hist_series_free(h->regs[r]);
+			h->regs[r] = NULL;
+		}
+	}
+	h->model = nd->model;
+}
+
+// a register reading; called for every one
+void
+oms_nd_hist_sample(OmsNode *nd, guint regaddr, guchar val)
+{
+	OmsHistSeries *hs;
+	time_t now;
+
+	if(!hist_topics || !om_model_table(nd->model))
+		return;
+	if(!nd->hist)
+		nd->hist = g_new0(OmsHist, 1);
+	if(nd->hist->model != nd->model)
+		oms_nd_hist_resolve(nd);
+	if(!(hs = nd->hist->regs[regaddr]))
+		return;
+	now = time(NULL);
+	hist_raw_add(hs, now, val);
+	hist_tier_add(&hs->min1, now, val);
+	hist_tier_add(&hs->min15, now, val);
+}
+
+void
+oms_nd_hist_free(OmsNode *nd)
+{
+	if(!nd->hist)
+		return;
+	for(int r = 0; r < 256; r++)
+		if(nd->hist->regs[r])
+			hist_series_free(nd->hist->regs[r]);
+	g_free(nd->hist);
+	nd->hist = NULL;
+}
+
+struct hist_query {
+	char reg[MQSTRSIZE];
+	char tier[8];
+	time_t from, to;
+};
+
+static void
+hist_query_kv(char *key, char *val, void *data)
+{
+	struct hist_query *q = data;
+	if(strcmp(key, "reg") == 0)
+		g_strlcpy(q->reg, val, sizeof(q->reg));
+	else if(strcmp(key, "tier") == 0)
+		g_strlcpy(q->tier, val, sizeof(q->tier));
+	else if(strcmp(key, "from") == 0)
+		q->from = strtol(val, NULL, 0);
+	else if(strcmp(key, "to") == 0)
+		q->to = strtol(val, NULL, 0);
+}
+
+// a value 16 times too big, as the register's unit where that's a linear scale
+static void
+hist_append_val(GString *s, struct omst_reg *reg, int v16)
+{
+	double raw = v16 / 16.0;
+	if(reg->cvt_str == omcs_temp) {
+		double t0 = omcf_temp(0, 1);
+		g_string_append_printf(s, "%.1f", t0 + (omcf_temp(1, 1) - t0) * raw);
+	} else if(v16 % 16 == 0)
+		g_string_append_printf(s, "%d", v16 / 16);
+	else
+		g_string_append_printf(s, "%.2f", raw);
+}
+
+static void
+hist_answer(OmsNode *nd, MqReplyTo *rt, GString *doc)
+{
+	if(rt)
+		mqtt_publish_reply(rt, doc->str, doc->len);
+	else {
+		OmsTopic topic = { NULL, 0, MQ_PUB_EVERY };
+		oms_topic_build(&topic, nd, "result/history");
+		mqtt_publish_topic(&topic, doc->str, doc->len);
+		g_free(topic.s);
+	}
+}
+
+static void
+hist_query_raw(GString *s, OmsHistSeries *hs, struct omst_reg *reg, time_t from, time_t to)
+{
+	time_t t = hs->base_t, prev = 0;
+	int v = hs->base_v;
+	int n = 0;
+	GString *vals = g_string_sized_new(256);
+
+	for(int i = 0; i < hs->count && n < HIST_MAX_POINTS; i++) {
+		int ix = (hs->head + i) % HIST_RAW_N;
+		t += hs->dt[ix];
+		v += hs->dv[ix];
+		if(t < from || t > to)
+			continue;
+		if(n == 0)
+			g_string_append_printf(s, ",\"start\":%ld,\"t\":[0", (long)t);
+		else
+			g_string_append_printf(s, ",%ld", (long)(t - prev));
+		if(n)
+			g_string_append_c(vals, ',');
+		hist_append_val(vals, reg, v * 16);
+		prev = t;
+		n++;
+	}
+	if(n == 0)
+		g_string_append_printf(s, ",\"start\":%ld,\"t\":[", (long)from);
+	g_string_append_printf(s, "],\"values\":[%s]", vals->str);
+	g_string_free(vals, TRUE);
+}
+
+static void
+hist_query_tier(GString *s, OmsHistTier *t, struct omst_reg *reg, time_t from, time_t to)
+{
+	gint64 first = from / t->step, last = to / t->step;
+	if(last - first >= HIST_MAX_POINTS)
+		first = last - HIST_MAX_POINTS + 1;
+	g_string_append_printf(s, ",\"start\":%ld,\"step\":%d,\"values\":[", (long)(first * t->step), t->step);
+	for(gint64 i = first; i <= last; i++) {
+		int v16 = hist_tier_get(t, i);
+		if(i > first)
+			g_string_append_c(s, ',');
+		if(v16 == HIST_EMPTY)
+			g_string_append(s, "null");
+		else
+			hist_append_val(s, reg, v16);
+	}
+	g_string_append(s, "]");
+}
+
+// mqtt: omnistat/<node>/history.  rt, if any, is ours to free.
+void
+oms_nd_history_query(OmsNode *nd, const char *payload, int len, MqReplyTo *rt)
+{
+	struct hist_query q = { "", "", 0, 0 };
+	struct omst_reg *regtab = om_model_table(nd->model);
+	time_t now = time(NULL);
+	OmsHistSeries *hs = NULL;
+	int regno = -1;
+	GString *doc = g_string_sized_new(1024);
+
+	if(kv_parse(payload, len, hist_query_kv, &q) > 0 && regtab)
+		regno = oms_nd_lookup_reg_by_topic(nd, q.reg);
+	if(regno >= 0 && nd->hist && nd->hist->model == nd->model)
+		hs = nd->hist->regs[regno];
+	if(!q.to)
+		q.to = now;
+	if(!q.from)
+		q.from = q.to - HIST_RAW_AGE;
+	if(!q.tier[0])
+		strcpy(q.tier, now - q.from <= HIST_RAW_AGE ? "raw" : now - q.from <= 24*3600 ? "1m" : "15m");
+
+	g_string_append(doc, "{\"reg\":");
+	json_append_str(doc, q.reg);
+	if(!hs || (strcmp(q.tier, "raw") && strcmp(q.tier, "1m") && strcmp(q.tier, "15m")))
+		g_string_append(doc, ",\"status\":\"badrequest\"}");
+	else {
+		g_string_append_printf(doc, ",\"tier\":\"%s\"", q.tier);
+		if(strcmp(q.tier, "raw") == 0)
+			hist_query_raw(doc, hs, &regtab[regno], q.from, q.to);
+		else if(strcmp(q.tier, "1m") == 0)
+			hist_query_tier(doc, &hs->min1, &regtab[regno], q.from, q.to);
+		else
+			hist_query_tier(doc, &hs->min15, &regtab[regno], q.from, q.to);
+		g_string_append(doc, "}");
+	}
+	hist_answer(nd, rt, doc);
+	g_string_free(doc, TRUE);
+	mq_reply_to_free(rt);
+}
@@ -0,0 +1,212 @@
+/*
+ * polling on demand: a faster poll rate for thermostats someone is watching.
+ *
+ * After a set or getreg command, a multi-register write, or an explicit
+ * omnistat/<node>/watch, the node's status block is read every boost_interval
+ * seconds (default 5) for boost_window seconds (default 60), on top of the
+ * per-minute sweep, and then it goes back to normal polling by itself.
+ * A watch payload may ask for a longer window, up to boost_window_max (600).
+ *
+ * Boosted reads share the bus with everything else.  Each round they may use
+ * at most boost_budget percent (default 30) of the bus time until the next
+ * round, going by the channel's average time per transaction, and none are
+ * added while the channel already has a backlog.  When the budget is short,
+ * the boosted nodes on a channel take turns.
+ *
+ * Sentinel polling, with poll=sentinel in [server]: instead of reading the
+ * 14-register status block from every live thermostat each minute, read one
+ * cheap sentinel every sentinel_interval seconds (default 15), and the full
+ * block only when the sentinel's value changes or the last full read is more
+ * than full_max_age seconds old (default 300).  The sentinel is the output
+ * status register (sentinel=outstatus, the default) or the 6-byte group 1
+ * data (sentinel=getg: setpoints, modes and temperature).  Thermostats that
+ * aren't alive are still swept every minute.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+
+#define BOOST_BUS_GUESS		100000	// microseconds per transaction before we've measured
+#define BOOST_BACKLOG		4	// queued messages above which no boosted reads are added
+
+#define ALIVE_AGE		130	// a status read older than this doesn't show a node is alive
+
+enum { POLL_SWEEP, POLL_SENTINEL };
+enum { SENTINEL_OUTSTATUS, SENTINEL_GETG };
+
+static int boost_window = 60;
+static int boost_window_max = 600;
+static int boost_interval = 5;
+static int boost_budget = 30;
+
+static int poll_mode = POLL_SWEEP;
+static int sentinel_kind = SENTINEL_OUTSTATUS;
+static int sentinel_interval = 15;
+static int full_max_age = 300;
+static guint sentinel_tag;
+
+void
+oms_poll_load_config(GKeyFile *kf)
+{
+	if(g_key_file_has_key(kf, "server", "boost_window", NULL))
+		boost_window = MAX(0, g_key_file_get_integer(kf, "server", "boost_window", NULL));
+	if(g_key_file_has_key(kf, "server", "boost_window_max", NULL))
+		boost_window_max = MAX(boost_window, g_key_file_get_integer(kf, "server", "boost_window_max", NULL));
+	if(g_key_file_has_key(kf, "server", "boost_interval", NULL))
+		boost_interval = MAX(1, g_key_file_get_integer(kf, "server", "boost_interval", NULL));
+	if(g_key_file_has_key(kf, "server", "boost_budget", NULL))
+		boost_budget = CLAMP(g_key_file_get_integer(kf, "server", "boost_budget", NULL), 0, 100);
+
+	char *s = g_key_file_get_string(kf, "server", "poll", NULL);
+	if(s) {
+		if(strcmp(s, "sentinel") == 0)
+			poll_mode = POLL_SENTINEL;
+		else if(strcmp(s, "sweep") != 0)
+			fprintf(stderr, "poll: unknown strategy %s\n", s);
+		g_free(s);
+	}
+	if((s = g_key_file_get_string(kf, "server", "sentinel", NULL))) {
+		if(strcmp(s, "getg") == 0)
+			sentinel_kind = SENTINEL_GETG;
+		else if(strcmp(s, "outstatus") != 0)
+			fprintf(stderr, "sentinel: unknown register %s\n", s);
+		g_free(s);
+	}
+	if(g_key_file_has_key(kf, "server", "sentinel_interval", NULL))
+		sentinel_interval = MAX(1, g_key_file_get_integer(kf, "server", "sentinel_interval", NULL));
+	if(g_key_file_has_key(kf, "server", "full_max_age", NULL))
+		full_max_age = MAX(sentinel_interval, g_key_file_get_integer(kf, "server", "full_max_age", NULL));
+}
+
+// one round of boosted reads on a channel.  stops itself once no node there is boosted.
+static gboolean
+oms_boost_tick(gpointer data)
+{
+	OmsChan *omc = data;
+	time_t now = time(NULL);
+	int n = omc->nodelist->len;
+	int boosted = 0;
+	gint64 per_read = omc->bus_us_avg ? omc->bus_us_avg : BOOST_BUS_GUESS;
+	int allowed = (gint64)boost_interval * G_USEC_PER_SEC * boost_budget / 100 / per_read;
+
+	if(g_list_length(omc->sendq) > BOOST_BACKLOG)
+		allowed = 0;
+	for(int i = 0, next = omc->boost_next; i < n; i++) {
+		int ix = (next + i) % n;
+		OmsNode *nd = g_ptr_array_index(omc->nodelist, ix);
+		if(nd->boost_until <= now)
+			continue;
+		boosted++;
+		if(allowed <= 0 || nd->state == NODE_DEAD)
+			continue;
+		// read recently anyway, by the sweep or a command
+		if(now - nd->reg_cache[OM_REGADDR_CURRENT_TEMP].vtime < boost_interval)
+			continue;
+		oms_node_send_msg_readregs(nd, OM_REGADDR_STATUS, OM_REGADDR_STATUS_LEN);
+		allowed--;
+		omc->boost_next = (ix + 1) % n;		// whoever missed out goes first next time
+	}
+	if(boosted)
+		return G_SOURCE_CONTINUE;
+	omc->boost_tag = 0;
+	return G_SOURCE_REMOVE;
+}
+
+// poll a node faster for the next secs seconds, or boost_window if secs is 0
+void
+oms_nd_boost(OmsNode *nd, int secs)
+{
+	OmsChan *omc = nd->omc;
+	time_t until;
+
+	if(secs <= 0)
+		secs = boost_window;
+	until = time(NULL) + MIN(secs, boost_window_max);
+	if(until > nd->boost_until)
+		nd->boost_until = until;
+	if(!omc->boost_tag && secs > 0)
+		omc->boost_tag = g_timeout_add(boost_interval * 1000, oms_boost_tick, omc);
+}
+
+// stop boosted polling on a channel that's going away
+void
+oms_chan_boost_stop(OmsChan *omc)
+{
+	if(omc->boost_tag)
+		g_source_remove(omc->boost_tag);
+	omc->boost_tag = 0;
+}
+
+// does the per-minute sweep still read this node?  with sentinel polling, only
+// until it's alive.
+gboolean
+oms_poll_swept(OmsNode *nd)
+{
+	return poll_mode == POLL_SWEEP || nd->state != NODE_ALIVE;
+}
+
+// seconds a status read counts towards a node being alive: a couple of sweeps,
+// or with sentinel polling, the longest we may go between full reads
+int
+oms_poll_alive_age()
+{
+	return poll_mode == POLL_SENTINEL ? MAX(ALIVE_AGE, full_max_age + sentinel_interval) : ALIVE_AGE;
+}
+
+static void
+oms_sentinel_done(OmsMessage *msg, int err)
+{
+	OmsNode *nd = msg->done_data;
+	int n = MIN(msg->rlength, sizeof(nd->sentinel));
+	int want = sentinel_kind == SENTINEL_GETG ? OMMS_GRP1 : OMMS_DATA;
+
+	if(err != KE_NOERROR || (msg->rstatus & 0x0f) != want || n < 1)
+		return;
+	if(nd->sentinel_len == n && memcmp(nd->sentinel, msg->rbuf, n) == 0)
+		return;
+	// something happened at the thermostat; go and see what
+	if(nd->sentinel_len)
+		oms_node_send_msg_readregs(nd, OM_REGADDR_STATUS, OM_REGADDR_STATUS_LEN);
+	memcpy(nd->sentinel, msg->rbuf, n);
+	nd->sentinel_len = n;
+}
+
+static gboolean
+oms_sentinel_tick(gpointer data)
+{
+	time_t now = time(NULL);
+
+	for(int c = 0; oms_chans && c < oms_chans->len; c++) {
+		OmsChan *omc = g_ptr_array_index(oms_chans, c);
+		for(int i = 0; i < omc->nodelist->len; i++) {
+			OmsNode *nd = g_ptr_array_index(omc->nodelist, i);
+			OmsMessage *msg;
+			if(nd->state != NODE_ALIVE)
+				continue;	// the per-minute sweep looks after it
+			if(now - nd->reg_cache[OM_REGADDR_CURRENT_TEMP].vtime >= full_max_age) {
+				oms_node_send_msg_readregs(nd, OM_REGADDR_STATUS, OM_REGADDR_STATUS_LEN);
+				continue;
+			}
+			if(sentinel_kind == SENTINEL_GETG)
+				msg = oms_chan_send_msg(omc, nd->addr, OMMT_GETG, NULL, 0);
+			else
+				msg = oms_node_send_msg_readregs(nd, OM_REGADDR_OUTPUT_STATE, 1);
+			msg->done = oms_sentinel_done;
+			msg->done_data = nd;
+		}
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+// start sentinel polling, if configured
+void
+oms_poll_init()
+{
+	if(poll_mode == POLL_SENTINEL && !sentinel_tag)
+		sentinel_tag = g_timeout_add_seconds(sentinel_interval, oms_sentinel_tick, NULL);
+}
@@ -0,0 +1,180 @@
+/*
+ * publish policies: which register readings actually get published.
+ *
+ * Without configuration, PUBA registers are published on every read and
+ * PUBC registers when they change, as before.  A [publish] section in the
+ * .ini file can set a policy per topic, or for all published registers with
+ * the key "default":
+ *
+ *	[publish]
+ *	current=deadband=0.5;min=60;max=900
+ *	outstatus=max=300
+ *	default=onchange=1;max=1800
+ *
+ *	onchange=0|1	publish only when the value changes (default 1 when configured)
+ *	deadband=<deg>	temperature registers: changes smaller than this don't count
+ *	min=<secs>	publish at most this often; changes in between are held back
+ *		        and go out on the first read after the interval
+ *	max=<secs>	publish at least this often while readings arrive, changed or not
+ *
+ * A getreg command always gets an answer, and everything is published again
+ * after a node has been dead, and whenever we connect to the broker.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+#include <utils.h>
+
+struct _OmsPubPolicy {
+	int onchange;
+	float deadband;
+	int min_interval;
+	int max_interval;
+};
+
+static GHashTable *oms_pub_policies;	// topic -> OmsPubPolicy
+static OmsPubPolicy *oms_pub_default;
+
+static const OmsPubPolicy pub_always = { 0, 0, 0, 0 };	// PUBA
+static const OmsPubPolicy pub_changed = { 1, 0, 0, 0 };	// PUBC
+
+static void
+oms_pub_policy_kv(char *key, char *val, void *data)
+{
+	OmsPubPolicy *pol = data;
+	if(strcmp(key, "onchange") == 0)
+		pol->onchange = atoi(val);
+	else if(strcmp(key, "deadband") == 0)
+		pol->deadband = atof(val);
+	else if(strcmp(key, "min") == 0)
+		pol->min_interval = atoi(val);
+	else if(strcmp(key, "max") == 0)
+		pol->max_interval = atoi(val);
+	else
+		fprintf(stderr, "[publish]: unknown policy setting %s\n", key);
+}
+
+// read the [publish] section of the config file
+void
+oms_pub_policy_load(GKeyFile *kf)
+{
+	gsize nkeys;
+	gchar **keys = g_key_file_get_keys(kf, "publish", &nkeys, NULL);
+	if(!keys)
+		return;
+	if(!oms_pub_policies)
+		oms_pub_policies = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	for(int i = 0; i < nkeys; i++) {
+		char *val = g_key_file_get_string(kf, "publish", keys[i], NULL);
+		OmsPubPolicy *pol = g_new0(OmsPubPolicy, 1);
+		pol->onchange = 1;
+		if(!val || kv_parse(val, strlen(val), oms_pub_policy_kv, pol) < 0) {
+			fprintf(stderr, "[publish]: can't parse %s=%s\n", keys[i], val ? val : "");
+			g_free(pol);
+		} else if(strcmp(keys[i], "default") == 0) {
+			g_free(oms_pub_default);
+			oms_pub_default = pol;
+		} else {
+			g_hash_table_replace(oms_pub_policies, g_strdup(keys[i]), pol);
+		}
+		g_free(val);
+	}
+	g_strfreev(keys);
+}
+
+// policy for one register of a model table, or NULL if it isn't published
+const OmsPubPolicy *
+oms_pub_policy_for(struct omst_reg *reg)
+{
+	OmsPubPolicy *pol = NULL;
+	if(!reg->topic)
+		return NULL;
+	if(oms_pub_policies && (pol = g_hash_table_lookup(oms_pub_policies, reg->topic)))
+		return pol;
+	if(!(reg->flags & (PUBA|PUBC)))
+		return NULL;
+	if(oms_pub_default)
+		return oms_pub_default;
+	return (reg->flags & PUBA) ? &pub_always : &pub_changed;
+}
+
+// decide whether a new reading of a register should be published, and if so
+// note it as the last published value.  until the model is known there are no
+// policies, and everything is published as it was before there were any.
+int
+oms_nd_pub_filter(OmsNode *nd, guint regaddr, guchar val)
+{
+	OmsRegVal *rv = &nd->reg_cache[regaddr];
+	const OmsPubPolicy *pol = nd->pub_pol ? nd->pub_pol[regaddr] : NULL;
+	struct omst_reg *regtab = om_model_table(nd->model);
+	time_t now = time(NULL);
+	int changed;
+
+	if((rv->flags & PUB_NEXT) || !nd->pub_pol)
+		goto publish;
+	if(!pol)
+		return 0;
+	if(rv->pubtime == 0)
+		goto publish;
+	if(pol->max_interval && now - rv->pubtime >= pol->max_interval)
+		goto publish;
+	if(pol->min_interval && now - rv->pubtime < pol->min_interval)
+		return 0;
+	if(!pol->onchange)
+		goto publish;
+
+	changed = (val != rv->pubval);
+	if(changed && pol->deadband > 0 && regtab && regtab[regaddr].cvt_str == omcs_temp)
+		changed = fabs(omcf_temp(val, 1) - omcf_temp(rv->pubval, 1)) >= pol->deadband;
+	if(!changed)
+		return 0;
+publish:
+	rv->pubval = val;
+	rv->pubtime = now;
+	rv->flags &= ~PUB_NEXT;
+	return 1;
+}
+
+// queue the node's state and every published value we have cached, for sending as
+// fast as the outbox drains.  for a new broker connection.  values keep the time
+// they were read, so their ts and expiry say how old they are.
+void
+oms_nd_republish(OmsNode *nd)
+{
+	char dbuf[MQSTRSIZE];
+	time_t now = time(NULL);
+
+	if(nd->state == NODE_ALIVE)
+		mq_outbox_put(nd->t_state.s, "alive", 5, nd->t_state.flags, now);
+	else
+		mq_outbox_put(nd->t_state.s, "dead", 4, nd->t_state.flags, now);
+	if(nd->state == NODE_DEAD || !nd->t_reg || nd->t_reg_model != nd->model)
+		return;		// cached values are stale, or we don't know how to show them
+	if(oms_doc_only()) {
+		oms_nd_doc_full(nd);
+		return;
+	}
+	for(int r = 0; r < 256; r++) {
+		OmsRegVal *rv = &nd->reg_cache[r];
+		if(!nd->pub_pol[r] || !rv->vtime || !nd->t_reg[r].s)
+			continue;
+		omcs_regval(dbuf, r, rv->val, nd->model);
+		mq_outbox_put(nd->t_reg[r].s, dbuf, strlen(dbuf), nd->t_reg[r].flags, rv->vtime);
+		rv->pubval = rv->val;
+		rv->pubtime = now;
+	}
+}
+
+// forget what was published, so every register goes out again on its next read
+void
+oms_nd_pub_reset(OmsNode *nd)
+{
+	for(int r = 0; r < 256; r++)
+		nd->reg_cache[r].pubtime = 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * equipment runtime from output status transitions.
+ *
+ * With runtime=true in [server], every reading of the output status register
+ * (0x48) is timed with the monotonic clock, and the time between readings is
+ * credited to whichever outputs were on: heat and cool (the run bit, split by
+ * the heat/cool bit), em-heat, fan and second stage.  When an output changed
+ * between two readings, the interval is split at its middle.  Gaps longer than
+ * runtime_gap seconds (default 600; a dead node, say) are not counted at all.
+ *
+ * Every runtime_rollup seconds (default 300) each node publishes on
+ * omnistat/<node>/runtime:
+ *
+ *	{"time":1700000300,"period":300,"since":1699990000,
+ *	 "on":{"heat":120.0,...},"duty":{"heat":0.400,...},"duty_1h":{"heat":0.310,...},
+ *	 "cycles":{"heat":1,...},"total":{"heat":5400.0,...}}
+ *
+ * on and cycles (off-to-on transitions) are for the period just ended, duty
+ * is on/period, duty_1h the same over the last hour, and total the seconds on
+ * since "since", when the daemon started counting for this node.  The
+ * resolution is the polling interval; sentinel polling (oms_poll.c) gives a
+ * much finer one than the per-minute sweep.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+
+enum { RT_HEAT, RT_COOL, RT_EMHEAT, RT_FAN, RT_STAGE2, RT_NOUT };
+static const char *rt_names[RT_NOUT] = { "heat", "cool", "emheat", "fan", "stage2" };
+
+#define RT_BUCKETS	60	// one-minute buckets for the rolling hour
+
+struct _OmsRuntime {
+	gint64 last_t;		// monotonic time of the last reading, 0 if none to count from
+	guchar last_val;
+	time_t since;
+
+	gint64 total_us[RT_NOUT];
+	gint64 period_us[RT_NOUT];
+	int cycles[RT_NOUT];
+	gint64 period_start;
+
+	gint64 bucket_us[RT_BUCKETS][RT_NOUT];
+	gint64 bucket_min[RT_BUCKETS];	// which minute each bucket holds
+	gint64 counted_us[RT_BUCKETS];	// time accounted for in it, on or off
+};
+
+static gboolean runtime_on;
+static int runtime_rollup = 300;
+static int runtime_gap = 600;
+static guint runtime_tag;
+
+void
+oms_runtime_load_config(GKeyFile *kf)
+{
+	runtime_on = g_key_file_get_boolean(kf, "server", "runtime", NULL);
+	if(g_key_file_has_key(kf, "server", "runtime_rollup", NULL))
+		runtime_rollup = MAX(10, g_key_file_get_integer(kf, "server", "runtime_rollup", NULL));
+	if(g_key_file_has_key(kf, "server", "runtime_gap", NULL))
+		runtime_gap = MAX(1, g_key_file_get_integer(kf, "server", "runtime_gap", NULL));
+}
+
+// which outputs an output status value has on, as a bit per RT_*
+static int
+rt_outputs(guchar v)
+{
+	int on = 0;
+	if(v & 4)
+		on |= 1 << ((v & 1) ? RT_HEAT : RT_COOL);
+	if(v & 2)
+		on |= 1 << RT_EMHEAT;
+	if(v & 8)
+		on |= 1 << RT_FAN;
+	if(v & 16)
+		on |= 1 << RT_STAGE2;
+	return on;
+}
+
+static void
+rt_credit(OmsRuntime *rt, int on, gint64 us, gint64 now)
+{
+	gint64 min = now / (60 * G_USEC_PER_SEC);
+	int b = min % RT_BUCKETS;
+
+	if(rt->bucket_min[b] != min) {
+		memset(rt->bucket_us[b], 0, sizeof(rt->bucket_us[b]));
+		rt->counted_us[b] = 0;
+		rt->bucket_min[b] = min;
+	}
+	rt->counted_us[b] += us;
+	for(int o = 0; o < RT_NOUT; o++) {
+		if(on & (1 << o)) {
+			rt->total_us[o] += us;
+			rt->period_us[o] += us;
+			rt->bucket_us[b][o] += us;
+		}
+	}
+}
+
+// a reading of the output status register
+void
+oms_nd_runtime_sample(OmsNode *nd, guchar val)
+{
+	OmsRuntime *rt;
+	gint64 now = g_get_monotonic_time();
+
+	if(!runtime_on)
+		return;
+	if(!(rt = nd->runtime)) {
+		rt = nd->runtime = g_new0(OmsRuntime, 1);
+		rt->since = time(NULL);
+		rt->period_start = now;
+	}
+	if(rt->last_t && now - rt->last_t <= (gint64)runtime_gap * G_USEC_PER_SEC) {
+		int was = rt_outputs(rt->last_val);
+		int is = rt_outputs(val);
+		gint64 dt = now - rt->last_t;
+		if(was == is)
+			rt_credit(rt, was, dt, now);
+		else {
+			// it changed somewhere in between; the middle is the best guess
+			rt_credit(rt, was, dt / 2, now);
+			rt_credit(rt, is, dt - dt / 2, now);
+			for(int o = 0; o < RT_NOUT; o++)
+				if((is & ~was) & (1 << o))
+					rt->cycles[o]++;
+		}
+	}
+	rt->last_t = now;
+	rt->last_val = val;
+}
+
+static void
+rt_append_secs(GString *s, const char *key, gint64 *us)
+{
+	g_string_append_printf(s, ",\"%s\":{", key);
+	for(int o = 0; o < RT_NOUT; o++)
+		g_string_append_printf(s, "%s\"%s\":%.1f", o ? "," : "", rt_names[o], us[o] / 1e6);
+	g_string_append(s, "}");
+}
+
+static void
+oms_nd_runtime_rollup(OmsNode *nd, gint64 now)
+{
+	OmsRuntime *rt = nd->runtime;
+	gint64 period = now - rt->period_start;
+	gint64 hour_on[RT_NOUT] = { 0 };
+	gint64 hour_counted = 0;
+	gint64 min = now / (60 * G_USEC_PER_SEC);
+
+	for(int b = 0; b < RT_BUCKETS; b++) {
+		if(min - rt->bucket_min[b] >= RT_BUCKETS)
+			continue;	// older than an hour
+		hour_counted += rt->counted_us[b];
+		for(int o = 0; o < RT_NOUT; o++)
+			hour_on[o] += rt->bucket_us[b][o];
+	}
+
+	GString *s = g_string_sized_new(512);
+	g_string_append_printf(s, "{\"time\":%ld,\"period\":%ld,\"since\":%ld",
+			       (long)time(NULL), (long)(period / G_USEC_PER_SEC), (long)rt->since);
+	rt_append_secs(s, "on", rt->period_us);
+	g_string_append(s, ",\"duty\":{");
+	for(int o = 0; o < RT_NOUT; o++)
+		g_string_append_printf(s, "%s\"%s\":%.3f", o ? "," : "", rt_names[o],
+				       period > 0 ? (double)rt->period_us[o] / period : 0.0);
+	g_string_append(s, "},\"duty_1h\":{");
+	for(int o = 0; o < RT_NOUT; o++)
+		g_string_append_printf(s, "%s\"%s\":%.3f", o ? "," : "", rt_names[o],
+				       hour_counted > 0 ? (double)hour_on[o] / hour_counted : 0.0);
+	g_string_append(s, "},\"cycles\":{");
+	for(int o = 0; o < RT_NOUT; o++)
+		g_string_append_printf(s, "%s\"%s\":%d", o ? "," : "", rt_names[o], rt->cycles[o]);
+	g_string_append(s, "}");
+	rt_append_secs(s, "total", rt->total_us);
+	g_string_append(s, "}");
+	mqtt_publish_topic(&nd->t_runtime, s->str, s->len);
+	g_string_free(s, TRUE);
+
+	memset(rt->period_us, 0, sizeof(rt->period_us));
+	memset(rt->cycles, 0, sizeof(rt->cycles));
+	rt->period_start = now;
+}
+
+static gboolean
+oms_runtime_tick(gpointer data)
+{
+	gint64 now = g_get_monotonic_time();
+	for(int c = 0; oms_chans && c < oms_chans->len; c++) {
+		OmsChan *omc = g_ptr_array_index(oms_chans, c);
+		for(int i = 0; i < omc->nodelist->len; i++) {
+			OmsNode *nd = g_ptr_array_index(omc->nodelist, i);
+			if(nd->runtime)
+				oms_nd_runtime_rollup(nd, now);
+		}
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+void
+oms_runtime_init()
+{
+	if(runtime_on && !runtime_tag)
+		runtime_tag = g_timeout_add_seconds(runtime_rollup, oms_runtime_tick, NULL);
+}
+
+void
+oms_nd_runtime_free(OmsNode *nd)
+{
+	g_free(nd->runtime);
+	nd->runtime = NULL;
+}
@@ -0,0 +1,242 @@
+/*
+ * whole-thermostat register snapshots, and multi-register reads.
+ *
+ * reads every readable register in a node's model table, or the registers
+ * named in a getmany command, with the fewest OMMT_GETREG transactions,
+ * then publishes the lot as one document.
+ * Only one read per snapshot is queued at a time, so several snapshots
+ * and the normal polling all take turns on the wire.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+#include <utils.h>
+
+struct _OmsSnapshot {
+	OmsNode *nd;
+	time_t start_time;
+	int nreads;	// planned reads
+	int next;	// index of next read to send
+	int failed;	// reads that NACKed or timed out
+	int starts[32];
+	int counts[32];
+	guchar want[256];
+	guchar got[256];	// read by this snapshot; an older cached value doesn't count
+
+	// getmany
+	OmsTopic result;	// result/getmany, or NULL for a snapshot
+	char *keys[256];	// the name each wanted register was asked for by
+	GString *rejected;	// names we couldn't use, as a JSON list body
+};
+
+static void oms_snap_next(OmsSnapshot *snap);
+
+static void
+oms_snap_read_done(OmsMessage *msg, int err)
+{
+	OmsSnapshot *snap = (OmsSnapshot *)msg->done_data;
+	if(err != KE_NOERROR || (msg->rstatus & 0x0f) != OMMS_DATA || msg->rlength < 2)
+		snap->failed++;
+	else {
+		for(int i = 0; i < msg->rlength - 1 && msg->rbuf[0] + i < 256; i++)
+			snap->got[msg->rbuf[0] + i] = 1;
+	}
+	oms_snap_next(snap);
+}
+
+// build and publish the snapshot document, from the values its own reads brought back.
+// registers are grouped in runs of consecutive values, as hex strings keyed by the starting register:
+// {"node":"house","addr":2,"model":"RC-80","time":1700000000,"missing":0,"regs":{"0":"0200..","9":"..."}}
+static void
+oms_snap_publish(OmsSnapshot *snap)
+{
+	OmsNode *nd = snap->nd;
+	char mbuf[MQSTRSIZE];
+	int missing = 0;
+	int inrun = 0;
+
+	omcs_model(mbuf, nd->model);
+	GString *doc = g_string_sized_new(1024);
+	g_string_append(doc, "{\"node\":");
+	json_append_str(doc, nd->name);
+	g_string_append_printf(doc, ",\"addr\":%d,\"model\":\"%s\",\"time\":%ld,\"regs\":{",
+			       nd->addr, mbuf, (long)snap->start_time);
+	for(int r = 0; r < 256; r++) {
+		int have = snap->want[r] && snap->got[r];
+		if(snap->want[r] && !have)
+			missing++;
+		if(have && !inrun)
+			g_string_append_printf(doc, "%s\"%d\":\"", (doc->str[doc->len-1] == '{') ? "" : ",", r);
+		else if(!have && inrun)
+			g_string_append_c(doc, '"');
+		if(have)
+			g_string_append_printf(doc, "%02x", nd->reg_cache[r].val);
+		inrun = have;
+	}
+	if(inrun)
+		g_string_append_c(doc, '"');
+	g_string_append_printf(doc, "},\"missing\":%d}", missing);
+
+	mqtt_publish_topic(&nd->t_snapshot, doc->str, doc->len);
+	if(nd->omc->flags & KCH_FLAG_VERBOSE)
+		printf("snapshot(%s): %d reads, %d failed, %d registers missing\n",
+		       nd->name, snap->nreads, snap->failed, missing);
+	g_string_free(doc, TRUE);
+}
+
+// {"status":"ok","reads":2,"errors":0,"values":{"cool_set":"24.0","hold":"off"},"missing":[],"rejected":[]}
+// status is ok, partial (some registers couldn't be read) or badrequest (no usable names)
+static void
+oms_getmany_publish(OmsSnapshot *snap)
+{
+	OmsNode *nd = snap->nd;
+	char dbuf[MQSTRSIZE];
+	GString *vals = g_string_sized_new(256);
+	GString *missing = g_string_new(NULL);
+	int nwant = 0;
+
+	for(int r = 0; r < 256; r++) {
+		if(!snap->want[r])
+			continue;
+		nwant++;
+		if(snap->got[r]) {
+			omcs_regval(dbuf, r, nd->reg_cache[r].val, nd->model);
+			if(vals->len)
+				g_string_append_c(vals, ',');
+			json_append_str(vals, snap->keys[r]);
+			g_string_append_printf(vals, ":\"%s\"", dbuf);
+		} else {
+			if(missing->len)
+				g_string_append_c(missing, ',');
+			json_append_str(missing, snap->keys[r]);
+		}
+	}
+	GString *doc = g_string_sized_new(512);
+	g_string_append_printf(doc, "{\"status\":\"%s\",\"reads\":%d,\"errors\":%d,\"values\":{%s},\"missing\":[%s],\"rejected\":[%s]}",
+			       !nwant ? "badrequest" : missing->len ? "partial" : "ok",
+			       snap->nreads, snap->failed, vals->str, missing->str, snap->rejected->str);
+	mqtt_publish_topic(&snap->result, doc->str, doc->len);
+	g_string_free(doc, TRUE);
+	g_string_free(vals, TRUE);
+	g_string_free(missing, TRUE);
+}
+
+static void
+oms_snap_free(OmsSnapshot *snap)
+{
+	for(int r = 0; r < 256; r++)
+		g_free(snap->keys[r]);
+	if(snap->rejected)
+		g_string_free(snap->rejected, TRUE);
+	g_free(snap->result.s);
+	g_free(snap);
+}
+
+static void
+oms_snap_next(OmsSnapshot *snap)
+{
+	OmsNode *nd = snap->nd;
+	if(snap->next < snap->nreads) {
+		OmsMessage *msg = oms_node_send_msg_readregs(nd, snap->starts[snap->next],
+							     snap->counts[snap->next]);
+		snap->next++;
+		msg->done = oms_snap_read_done;
+		msg->done_data = snap;
+		return;
+	}
+	if(snap->result.s)
+		oms_getmany_publish(snap);
+	else
+		oms_snap_publish(snap);
+	nd->snap = NULL;
+	oms_snap_free(snap);
+}
+
+// start a snapshot of all readable registers of a node.
+// does nothing if one is already running for this node.
+void
+oms_nd_snapshot(OmsNode *nd)
+{
+	static const char unknown[] = "{\"error\":\"model unknown\"}";
+	struct omst_reg *regtab = om_model_table(nd->model);
+	int max_regs = om_model_table_size(nd->model);
+
+	if(nd->snap)
+		return;
+	if(!regtab || !oms_nd_reg_fresh(nd, OM_REGADDR_MODEL)) {
+		fprintf(stderr, "omnistat(%s) snapshot: model not known yet\n", nd->name);
+		mqtt_publish_topic(&nd->t_snapshot, unknown, sizeof(unknown)-1);
+		return;
+	}
+
+	OmsSnapshot *snap = g_new0(OmsSnapshot, 1);
+	snap->nd = nd;
+	snap->start_time = time(NULL);
+	for(int r = 0; r < max_regs && r < 256; r++)
+		snap->want[r] = (regtab[r].flags & ROK) != 0;   // RESV registers have no ROK
+	snap->nreads = oms_plan_reads(snap->want, MIN(max_regs, 256), snap->starts, snap->counts, 32);
+	if(nd->omc->flags & KCH_FLAG_VERBOSE)
+		printf("snapshot(%s): %d registers in %d reads\n", nd->name, max_regs, snap->nreads);
+	nd->snap = snap;
+	oms_snap_next(snap);
+}
+
+// forget a snapshot in progress; its queued reads must already have been dropped
+void
+oms_nd_snapshot_cancel(OmsNode *nd)
+{
+	if(nd->snap)
+		oms_snap_free(nd->snap);
+	nd->snap = NULL;
+}
+
+static void
+oms_getmany_name(char *name, void *data)
+{
+	OmsSnapshot *snap = data;
+	OmsNode *nd = snap->nd;
+	struct omst_reg *regtab = om_model_table(nd->model);
+	int regno = oms_nd_lookup_reg(nd, name);
+
+	if(regno < 0 || !(regtab[regno].flags & ROK) || snap->want[regno]) {
+		if(snap->rejected->len)
+			g_string_append_c(snap->rejected, ',');
+		json_append_str(snap->rejected, name);
+		return;
+	}
+	snap->want[regno] = 1;
+	snap->keys[regno] = g_strdup(name);
+}
+
+// mqtt: omnistat/<node>/getmany.  payload names the registers, as a JSON array or
+// list of names (topics, table names or numbers); reads them all, in as few
+// transactions as contiguous runs allow, and publishes one result on
+// omnistat/<node>/result/getmany.
+void
+oms_nd_getmany(OmsNode *nd, const char *payload, int len)
+{
+	OmsTopic result = { NULL, 0, MQ_PUB_EVERY };
+	int max_regs = om_model_table_size(nd->model);
+
+	oms_topic_build(&result, nd, "result/getmany");
+	if(nd->snap || !om_model_table(nd->model)) {
+		const char *busy = nd->snap ? "{\"status\":\"busy\"}" : "{\"status\":\"badrequest\"}";
+		mqtt_publish_topic(&result, busy, strlen(busy));
+		g_free(result.s);
+		return;
+	}
+	OmsSnapshot *snap = g_new0(OmsSnapshot, 1);
+	snap->nd = nd;
+	snap->start_time = time(NULL);
+	snap->result = result;
+	snap->rejected = g_string_new(NULL);
+	if(name_list_parse(payload, len, oms_getmany_name, snap) < 0)
+		memset(snap->want, 0, sizeof(snap->want));	// reported as badrequest
+	snap->nreads = oms_plan_reads(snap->want, MIN(max_regs, 256), snap->starts, snap->counts, 32);
+	nd->snap = snap;
+	oms_snap_next(snap);
+}
@@ -0,0 +1,187 @@
+/*
+ * durable history: every register reading appended to memory-mapped segment files.
+ *
+ * With store_dir=<directory> in [server], each register value that goes into
+ * reg_cache is also written as a 16-byte record (layout in oms_store.h) to the
+ * current segment, <store_dir>/<device>-<YYYYmmdd-HHMMSS.mmm>.oms.  A segment is
+ * created at its full size (store_records records, default 1M; sparse until
+ * used), mapped, and appended to in place.  A new one is started every
+ * store_rotate seconds (default 86400), when it is full, and at each restart;
+ * a finished segment is cut down to what it holds.  Dirty pages are flushed
+ * every few seconds, so a crash loses at most that much.
+ *
+ * Record times never go backwards within a segment, so a time range is found
+ * by binary search; omsexport does that to stream a node/register/time range
+ * as CSV or raw records.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <oms_store.h>
+
+#define STORE_SYNC	5	// seconds between flushes
+
+extern char *g_devname_noslash;
+
+static char *store_dir;
+static int store_rotate = 86400;
+static guint64 store_records = 1 << 20;
+
+static int seg_fd = -1;
+static char *seg_path;
+static void *seg_map;
+static size_t seg_len;
+static OmsStoreHeader *seg_hdr;
+static OmsStoreRec *seg_recs;
+static guint seg_gen;		// bumped for every new segment, so nodes know to look up their index again
+static gint64 seg_last_ms;
+static guint store_sync_tag;
+
+void
+oms_store_load_config(GKeyFile *kf)
+{
+	store_dir = g_key_file_get_string(kf, "server", "store_dir", NULL);
+	if(g_key_file_has_key(kf, "server", "store_rotate", NULL))
+		store_rotate = MAX(60, g_key_file_get_integer(kf, "server", "store_rotate", NULL));
+	if(g_key_file_has_key(kf, "server", "store_records", NULL))
+		store_records = MAX(1024, g_key_file_get_integer(kf, "server", "store_records", NULL));
+}
+
+static gboolean
+oms_store_sync(gpointer data)
+{
+	if(seg_hdr)
+		msync(seg_map, OMS_STORE_HDR + seg_hdr->count * sizeof(OmsStoreRec), MS_ASYNC);
+	return G_SOURCE_CONTINUE;
+}
+
+// finish the current segment: flush it, and give back the space it didn't use
+static void
+oms_store_close_segment()
+{
+	size_t used;
+
+	if(!seg_hdr)
+		return;
+	used = OMS_STORE_HDR + seg_hdr->count * sizeof(OmsStoreRec);
+	msync(seg_map, used, MS_SYNC);
+	munmap(seg_map, seg_len);
+	if(ftruncate(seg_fd, used) < 0)
+		fprintf(stderr, "store %s: truncate: %s\n", seg_path, strerror(errno));
+	close(seg_fd);
+	seg_fd = -1;
+	seg_map = NULL;
+	seg_hdr = NULL;
+	seg_recs = NULL;
+	g_free(seg_path);
+	seg_path = NULL;
+}
+
+static int
+oms_store_open_segment(gint64 now_ms)
+{
+	char stamp[32];
+	time_t t = now_ms / 1000;
+
+	strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&t));
+	seg_path = g_strdup_printf("%s/%s-%s.%03d%s", store_dir, g_devname_noslash ? g_devname_noslash : "mqoms",
+				   stamp, (int)(now_ms % 1000), OMS_STORE_SUFFIX);
+	seg_len = OMS_STORE_HDR + store_records * sizeof(OmsStoreRec);
+	if((seg_fd = open(seg_path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644)) < 0
+	   || ftruncate(seg_fd, seg_len) < 0
+	   || (seg_map = mmap(NULL, seg_len, PROT_READ | PROT_WRITE, MAP_SHARED, seg_fd, 0)) == MAP_FAILED) {
+		fprintf(stderr, "store %s: %s; not recording\n", seg_path, strerror(errno));
+		if(seg_fd >= 0)
+			close(seg_fd);
+		seg_fd = -1;
+		seg_map = NULL;
+		g_free(seg_path);
+		seg_path = NULL;
+		g_free(store_dir);
+		store_dir = NULL;	// don't keep trying on every reading
+		return -1;
+	}
+	seg_hdr = seg_map;
+	seg_recs = (OmsStoreRec *)((char *)seg_map + OMS_STORE_HDR);
+	memcpy(seg_hdr->magic, OMS_STORE_MAGIC, sizeof(seg_hdr->magic));
+	seg_hdr->version = OMS_STORE_VERSION;
+	seg_hdr->recsize = sizeof(OmsStoreRec);
+	seg_hdr->start_ms = now_ms;
+	seg_hdr->capacity = store_records;
+	seg_gen++;
+	seg_last_ms = now_ms;
+	if(!store_sync_tag)
+		store_sync_tag = g_timeout_add_seconds(STORE_SYNC, oms_store_sync, NULL);
+	printf("store: recording to %s\n", seg_path);
+	return 0;
+}
+
+// this node's index in the current segment's name table, adding it if need be.
+// -1 if the table is full.
+static int
+oms_store_node_id(OmsNode *nd)
+{
+	if(nd->store_gen == seg_gen)
+		return nd->store_id;
+	for(int i = 0; i < seg_hdr->nnames; i++) {
+		if(strncmp(seg_hdr->names[i], nd->name, OMS_STORE_NAMELEN - 1) == 0) {
+			nd->store_id = i;
+			nd->store_gen = seg_gen;
+			return i;
+		}
+	}
+	if(seg_hdr->nnames == OMS_STORE_NAMES)
+		return -1;
+	g_strlcpy(seg_hdr->names[seg_hdr->nnames], nd->name, OMS_STORE_NAMELEN);
+	nd->store_id = seg_hdr->nnames++;
+	nd->store_gen = seg_gen;
+	return nd->store_id;
+}
+
+// a register reading
+void
+oms_nd_store_sample(OmsNode *nd, guint regaddr, guchar val)
+{
+	gint64 now_ms;
+	int id;
+	OmsStoreRec *rec;
+
+	if(!store_dir)
+		return;
+	now_ms = g_get_real_time() / 1000;
+	if(seg_hdr && (seg_hdr->count == seg_hdr->capacity
+		       || now_ms - seg_hdr->start_ms >= (gint64)store_rotate * 1000
+		       || (nd->store_gen != seg_gen && seg_hdr->nnames == OMS_STORE_NAMES)))
+		oms_store_close_segment();
+	if(!seg_hdr && oms_store_open_segment(now_ms) < 0)
+		return;
+	if((id = oms_store_node_id(nd)) < 0)
+		return;
+
+	rec = &seg_recs[seg_hdr->count];
+	rec->t_ms = MAX(now_ms, seg_last_ms);	// the clock may step back; the index mustn't
+	rec->node = id;
+	rec->reg = regaddr;
+	rec->val = val;
+	rec->model = nd->model;
+	seg_last_ms = rec->t_ms;
+	// the record is complete before a reader can see it
+	__atomic_store_n(&seg_hdr->count, seg_hdr->count + 1, __ATOMIC_RELEASE);
+}
+
+// on the way out
+void
+oms_store_close()
+{
+	oms_store_close_segment();
+	if(store_sync_tag)
+		g_source_remove(store_sync_tag);
+	store_sync_tag = 0;
+}
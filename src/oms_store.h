@@ -0,0 +1,43 @@
+/*
+ * on-disk layout of history store segments, shared by the daemon (oms_store.c)
+ * and the exporter (omsexport.c).
+ *
+ * A segment is a header of OMS_STORE_HDR bytes followed by fixed-size records
+ * in time order.  The writer fills in a record and then bumps count, so a
+ * reader never sees a partial one; records past count are not valid.
+ * Integers are in host byte order.
+ */
+#ifndef OMS_STORE_H
+#define OMS_STORE_H
+
+#include <stdint.h>
+
+#define OMS_STORE_MAGIC		"OMSSEG1"
+#define OMS_STORE_VERSION	1
+#define OMS_STORE_HDR		8192
+#define OMS_STORE_NAMES		240	// distinct nodes per segment
+#define OMS_STORE_NAMELEN	32	// longer names are cut short
+#define OMS_STORE_SUFFIX	".oms"
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t recsize;	// sizeof(OmsStoreRec)
+	int64_t start_ms;	// unix milliseconds when the segment was opened
+	uint64_t count;		// records written
+	uint64_t capacity;	// records the file has room for
+	uint32_t nnames;
+	uint32_t pad;
+	char names[OMS_STORE_NAMES][OMS_STORE_NAMELEN];	// by OmsStoreRec.node
+} OmsStoreHeader;
+
+typedef struct {
+	int64_t t_ms;		// unix milliseconds; never decreases within a segment
+	uint16_t node;		// index into the header's names
+	uint8_t reg;
+	uint8_t val;		// raw register value
+	uint8_t model;
+	uint8_t pad[3];
+} OmsStoreRec;
+
+#endif
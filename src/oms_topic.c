@@ -0,0 +1,141 @@
+/*
+ * interned mqtt topic strings.
+ *
+ * Every topic a node publishes on is built once, from the topic_format
+ * template in the [server] section, when the node is added or when its
+ * model becomes known (register topics depend on the model table).
+ * Publishing then just hands the prebuilt string and its length to mosquitto.
+ *
+ * Template escapes:  %n node name, %a node address, %t topic within the node
+ * (state, current, a register's topic, ...), %% a percent sign.
+ * Command topics are not affected; they stay under omnistat/<node>/.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+
+#define OMS_TOPIC_FORMAT_DEFAULT "omnistat/%n/%t"
+
+static char *oms_topic_format = OMS_TOPIC_FORMAT_DEFAULT;
+
+// set the template; NULL restores the default.
+// returns 0, or -1 if the template can't tell nodes apart, in which case the default is kept.
+int
+oms_topic_set_format(const char *fmt)
+{
+	if(!fmt) {
+		oms_topic_format = OMS_TOPIC_FORMAT_DEFAULT;
+		return 0;
+	}
+	if(!strstr(fmt, "%t") || (!strstr(fmt, "%n") && !strstr(fmt, "%a"))) {
+		fprintf(stderr, "topic_format \"%s\" needs %%t and one of %%n or %%a; using %s\n",
+			fmt, OMS_TOPIC_FORMAT_DEFAULT);
+		return -1;
+	}
+	oms_topic_format = g_strdup(fmt);
+	return 0;
+}
+
+// expand the template for one topic of a node into t, replacing what was there
+void
+oms_topic_build(OmsTopic *t, OmsNode *nd, const char *sub)
+{
+	GString *s = g_string_sized_new(64);
+	for(const char *cp = oms_topic_format; *cp; cp++) {
+		if(*cp != '%' || !cp[1]) {
+			g_string_append_c(s, *cp);
+			continue;
+		}
+		switch(*++cp) {
+		case 'n':
+			g_string_append(s, nd->name);
+			break;
+		case 'a':
+			g_string_append_printf(s, "%d", nd->addr);
+			break;
+		case 't':
+			g_string_append(s, sub);
+			break;
+		default:
+			g_string_append_c(s, *cp);
+		}
+	}
+	g_free(t->s);
+	t->len = s->len;
+	t->s = g_string_free(s, FALSE);
+}
+
+static void
+oms_topic_clear(OmsTopic *t)
+{
+	g_free(t->s);
+	t->s = NULL;
+	t->len = 0;
+}
+
+// topics that don't depend on the model.  called when the node is added.
+void
+oms_nd_topics_init(OmsNode *nd)
+{
+	oms_topic_build(&nd->t_state, nd, "state");
+	nd->t_state.flags = MQ_PUB_PRIO | MQ_PUB_ALIAS | mqtt_retain_flags();
+	oms_topic_build(&nd->t_current, nd, "current");
+	nd->t_current.flags = MQ_PUB_ALIAS | MQ_PUB_TELEMETRY | mqtt_retain_flags();
+	oms_topic_build(&nd->t_snapshot, nd, "snapshot");
+	nd->t_snapshot.flags = MQ_PUB_EVERY;
+	oms_topic_build(&nd->t_doc, nd, "doc");
+	nd->t_doc.flags = MQ_PUB_ALIAS | MQ_PUB_TELEMETRY | mqtt_retain_flags();
+	oms_topic_build(&nd->t_bin, nd, "bin/regs");
+	nd->t_bin.flags = MQ_PUB_ALIAS | MQ_PUB_TELEMETRY | MQ_PUB_EVERY;	// frames for different registers share it
+	oms_topic_build(&nd->t_runtime, nd, "runtime");
+	nd->t_runtime.flags = MQ_PUB_ALIAS | mqtt_retain_flags();
+}
+
+// per-register topics and publish policies from the node's model table.  called when
+// the model register is read; does nothing if they were already built for this model.
+void
+oms_nd_topics_model(OmsNode *nd)
+{
+	struct omst_reg *regtab = om_model_table(nd->model);
+	int max_regs = om_model_table_size(nd->model);
+
+	if(!regtab || (nd->t_reg && nd->t_reg_model == nd->model))
+		return;
+	if(!nd->t_reg) {
+		nd->t_reg = g_new0(OmsTopic, 256);
+		nd->pub_pol = g_new0(const OmsPubPolicy *, 256);
+	}
+	for(int r = 0; r < 256; r++) {
+		if(r < max_regs && regtab[r].topic) {
+			oms_topic_build(&nd->t_reg[r], nd, regtab[r].topic);
+			nd->t_reg[r].flags = MQ_PUB_ALIAS | MQ_PUB_TELEMETRY | mqtt_retain_flags();
+			nd->pub_pol[r] = oms_pub_policy_for(&regtab[r]);
+		} else {
+			oms_topic_clear(&nd->t_reg[r]);
+			nd->pub_pol[r] = NULL;
+		}
+	}
+	nd->t_reg_model = nd->model;
+}
+
+void
+oms_nd_topics_free(OmsNode *nd)
+{
+	oms_topic_clear(&nd->t_state);
+	oms_topic_clear(&nd->t_current);
+	oms_topic_clear(&nd->t_snapshot);
+	oms_topic_clear(&nd->t_doc);
+	oms_topic_clear(&nd->t_bin);
+	oms_topic_clear(&nd->t_runtime);
+	if(nd->t_reg) {
+		for(int r = 0; r < 256; r++)
+			oms_topic_clear(&nd->t_reg[r]);
+		g_free(nd->t_reg);
+		nd->t_reg = NULL;
+		g_free(nd->pub_pol);
+		nd->pub_pol = NULL;
+	}
+}
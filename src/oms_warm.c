@@ -0,0 +1,227 @@
+/*
+ * warm restart: node state and register cache kept in a snapshot file.
+ *
+ * With warm_file=<path> in [server], every node's state, model and cached
+ * register values are written to a memory-mapped file every warm_interval
+ * seconds (default 60) and on shutdown.  At startup, if the file is no older
+ * than warm_max_age seconds (default 600), each configured node found in it,
+ * same name, address and serial device, gets its register cache back, and a
+ * node that was alive comes back alive at once, with its static registers
+ * known, instead of working through model, status and static reads first.
+ *
+ * That is only provisional: the first sweep (or sentinel read) is the
+ * verification read, and a node that doesn't answer it within the usual
+ * timeout goes dead and starts a fresh life cycle like any other.
+ *
+ * The file is rewritten in place.  Its header has a sequence number that is
+ * odd while a write is in progress, so a snapshot torn by a crash is ignored.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+
+extern int g_verbose;
+
+#define WARM_MAGIC	"OMSWARM1"
+#define WARM_VERSION	1
+
+typedef struct {
+	char magic[8];
+	guint32 version;
+	guint32 recsize;
+	guint32 seq;		// odd while being written
+	guint32 nnodes;
+	gint64 saved;		// unix time of the last complete write
+} WarmHeader;
+
+typedef struct {
+	char dev[64];
+	char name[64];
+	guint8 addr;
+	guint8 model;
+	guint8 state;
+	guint8 pad;
+	guint32 last_resp;
+	guint8 val[256];
+	guint32 vtime[256];	// 0 if no value
+} WarmRec;
+
+static char *warm_file;
+static int warm_interval = 60;
+static int warm_max_age = 600;
+static guint warm_tag;
+
+static int warm_fd = -1;
+static void *warm_map;
+static size_t warm_len;
+
+void
+oms_warm_load_config(GKeyFile *kf)
+{
+	warm_file = g_key_file_get_string(kf, "server", "warm_file", NULL);
+	if(g_key_file_has_key(kf, "server", "warm_interval", NULL))
+		warm_interval = MAX(5, g_key_file_get_integer(kf, "server", "warm_interval", NULL));
+	if(g_key_file_has_key(kf, "server", "warm_max_age", NULL))
+		warm_max_age = MAX(0, g_key_file_get_integer(kf, "server", "warm_max_age", NULL));
+}
+
+static void
+oms_warm_restore_node(const WarmRec *wr, time_t now)
+{
+	OmsNode *nd = oms_node_lookup(wr->name, strnlen(wr->name, sizeof(wr->name)));
+
+	if(!nd || nd->addr != wr->addr || strncmp(nd->omc->fname, wr->dev, sizeof(wr->dev)) != 0)
+		return;		// not configured any more, or moved
+	if(!wr->vtime[OM_REGADDR_MODEL] || wr->val[OM_REGADDR_MODEL] != wr->model)
+		return;		// never got far enough to be worth it
+
+	for(int r = 0; r < 256; r++) {
+		nd->reg_cache[r].val = wr->val[r];
+		nd->reg_cache[r].vtime = wr->vtime[r];
+		nd->reg_cache[r].flags = 0;
+		nd->reg_cache[r].pubtime = 0;
+	}
+	nd->model = wr->model;
+	oms_nd_topics_model(nd);
+	nd->cur_temp = omcf_temp(wr->val[OM_REGADDR_CURRENT_TEMP], 1);
+	if(wr->state == NODE_ALIVE) {
+		// a full reply timeout from now for the verification read to come back
+		nd->state = NODE_ALIVE;
+		nd->last_resp = now;
+	}
+	if(g_verbose)
+		printf("omnistat(%s) restored from %s, %s\n", nd->name, warm_file,
+		       nd->state == NODE_ALIVE ? "provisionally alive" : "not alive");
+}
+
+// reload the snapshot, if it's recent.  after the nodes are set up, before polling starts.
+void
+oms_warm_restore()
+{
+	int fd;
+	struct stat st;
+	void *map;
+	const WarmHeader *hdr;
+	time_t now = time(NULL);
+
+	if(!warm_file)
+		return;
+	if((fd = open(warm_file, O_RDONLY | O_CLOEXEC)) < 0) {
+		if(errno != ENOENT)
+			fprintf(stderr, "warm %s: %s\n", warm_file, strerror(errno));
+		return;
+	}
+	if(fstat(fd, &st) < 0 || st.st_size < sizeof(WarmHeader)
+	   || (map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		close(fd);
+		return;
+	}
+	close(fd);
+	hdr = map;
+	if(memcmp(hdr->magic, WARM_MAGIC, sizeof(hdr->magic)) || hdr->version != WARM_VERSION
+	   || hdr->recsize != sizeof(WarmRec) || (hdr->seq & 1)
+	   || st.st_size < sizeof(WarmHeader) + (size_t)hdr->nnodes * sizeof(WarmRec)) {
+		fprintf(stderr, "warm %s: unusable snapshot, ignored\n", warm_file);
+	} else if(now - hdr->saved > warm_max_age || hdr->saved > now + 60) {
+		printf("warm %s: snapshot is %ld seconds old, ignored\n", warm_file, (long)(now - hdr->saved));
+	} else {
+		const WarmRec *recs = (const WarmRec *)(hdr + 1);
+		for(int i = 0; i < hdr->nnodes; i++)
+			oms_warm_restore_node(&recs[i], now);
+		printf("warm %s: %d nodes from %ld seconds ago\n", warm_file, hdr->nnodes, (long)(now - hdr->saved));
+	}
+	munmap(map, st.st_size);
+}
+
+// (re)size the file and its mapping for n nodes
+static int
+oms_warm_map(int n)
+{
+	size_t len = sizeof(WarmHeader) + n * sizeof(WarmRec);
+
+	if(warm_map && len == warm_len)
+		return 0;
+	if(warm_map)
+		munmap(warm_map, warm_len);
+	warm_map = NULL;
+	if(warm_fd < 0 && (warm_fd = open(warm_file, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+		fprintf(stderr, "warm %s: %s\n", warm_file, strerror(errno));
+		return -1;
+	}
+	if(ftruncate(warm_fd, len) < 0
+	   || (warm_map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, warm_fd, 0)) == MAP_FAILED) {
+		fprintf(stderr, "warm %s: %s\n", warm_file, strerror(errno));
+		warm_map = NULL;
+		return -1;
+	}
+	warm_len = len;
+	return 0;
+}
+
+// write the snapshot; sync says whether to wait for it to reach the disk
+void
+oms_warm_save(gboolean sync)
+{
+	WarmHeader *hdr;
+	WarmRec *wr;
+	int n = 0;
+
+	if(!warm_file)
+		return;
+	for(int c = 0; oms_chans && c < oms_chans->len; c++)
+		n += ((OmsChan *)g_ptr_array_index(oms_chans, c))->nodelist->len;
+	if(oms_warm_map(n) < 0)
+		return;
+
+	hdr = warm_map;
+	wr = (WarmRec *)(hdr + 1);
+	__atomic_store_n(&hdr->seq, hdr->seq | 1, __ATOMIC_RELEASE);
+	for(int c = 0; oms_chans && c < oms_chans->len; c++) {
+		OmsChan *omc = g_ptr_array_index(oms_chans, c);
+		for(int i = 0; i < omc->nodelist->len; i++, wr++) {
+			OmsNode *nd = g_ptr_array_index(omc->nodelist, i);
+			memset(wr, 0, sizeof(*wr));
+			g_strlcpy(wr->dev, omc->fname, sizeof(wr->dev));
+			g_strlcpy(wr->name, nd->name, sizeof(wr->name));
+			wr->addr = nd->addr;
+			wr->model = nd->model;
+			wr->state = nd->state;
+			wr->last_resp = nd->last_resp;
+			for(int r = 0; r < 256; r++) {
+				wr->val[r] = nd->reg_cache[r].val;
+				wr->vtime[r] = nd->reg_cache[r].vtime;
+			}
+		}
+	}
+	memcpy(hdr->magic, WARM_MAGIC, sizeof(hdr->magic));
+	hdr->version = WARM_VERSION;
+	hdr->recsize = sizeof(WarmRec);
+	hdr->nnodes = n;
+	hdr->saved = time(NULL);
+	__atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELEASE);
+	msync(warm_map, warm_len, sync ? MS_SYNC : MS_ASYNC);
+}
+
+static gboolean
+oms_warm_tick(gpointer data)
+{
+	oms_warm_save(FALSE);
+	return G_SOURCE_CONTINUE;
+}
+
+// start the periodic snapshots, if configured
+void
+oms_warm_init()
+{
+	if(warm_file && !warm_tag)
+		warm_tag = g_timeout_add_seconds(warm_interval, oms_warm_tick, NULL);
+}
@@ -0,0 +1,421 @@
+/*
+ * multi-register write jobs.
+ *
+ * A job collects a set of register values for one node, then runs in phases:
+ *   read	fetch any requested registers whose cached value isn't fresh
+ *   write	write only the registers that differ from the cache, packing
+ *		contiguous runs into OMMT_SETREG frames of up to 14 data bytes
+ *   verify	read the written registers back with the fewest range reads
+ * and finally publishes one summary on omnistat/<node>/result/<cmd>.
+ *
+ * A transaction job (oms_nd_txn_begin) also remembers the values it is about to
+ * overwrite; if any write NACKs, times out twice, or reads back wrong, it writes
+ * the old values back and verifies those:
+ *   rollback	write the captured prior values of every changed register
+ *   rbverify	read them back
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <glib.h>
+#include <mqoms.h>
+#include <omnistat.h>
+#include <utils.h>
+
+enum wjob_phase { WJ_READ, WJ_WRITE, WJ_VERIFY, WJ_ROLLBACK, WJ_RBVERIFY, WJ_DONE };
+
+#define WJOB_RETRIES	2	// timed-out frames resent per job
+
+struct _OmsWriteJob {
+	OmsNode *nd;
+	char *cmd;
+	OmsTopic topic;		// result/<cmd>
+	enum wjob_phase phase;
+	int pending;		// messages queued in this phase and not yet finished
+	int badreq;		// payload couldn't be parsed
+	int txn;		// roll back on failure
+	time_t write_time;	// when the write (or rollback) phase started
+	int retries;
+
+	int nchanged;
+	int nwrites;		// OMMT_SETREG frames sent
+	int nreads;		// OMMT_GETREG reads sent, including pre-reads
+	int read_errors;	// NACKs and timeouts reading prior values
+	int errors;		// NACKs and timeouts writing and verifying
+	int rb_errors;		// errors during rollback
+
+	guchar want[256];	// registers named in the request
+	guchar value[256];	// requested raw values
+	guchar changed[256];	// registers written
+	guchar prior[256];	// cached values before writing, for rollback
+	GString *rejected;	// request keys we couldn't use, as a JSON list body
+
+	void (*done)(OmsWriteJob *job, const char *status, gpointer data);
+	gpointer done_data;
+};
+
+static void oms_wjob_advance(OmsWriteJob *job);
+
+OmsWriteJob *
+oms_wjob_new(OmsNode *nd, const char *cmd)
+{
+	OmsWriteJob *job = g_new0(OmsWriteJob, 1);
+	job->nd = nd;
+	job->cmd = g_strdup(cmd);
+	char *sub = g_strdup_printf("result/%s", cmd);
+	oms_topic_build(&job->topic, nd, sub);
+	job->topic.flags = MQ_PUB_EVERY;
+	g_free(sub);
+	job->rejected = g_string_new(NULL);
+	return job;
+}
+
+static void
+oms_wjob_free(OmsWriteJob *job)
+{
+	g_string_free(job->rejected, TRUE);
+	g_free(job->cmd);
+	g_free(job->topic.s);
+	g_free(job);
+}
+
+static void
+oms_wjob_reject(OmsWriteJob *job, char *key)
+{
+	if(job->rejected->len)
+		g_string_append_c(job->rejected, ',');
+	json_append_str(job->rejected, key);
+}
+
+// add one register to the job.  key is anything oms_nd_lookup_reg understands, and the register
+// must have all of reqflags set in the model table.  valstr is converted with the table's routine.
+// returns the register number, or -1 if the key was rejected.
+int
+oms_wjob_set_str(OmsWriteJob *job, char *key, char *valstr, int reqflags)
+{
+	OmsNode *nd = job->nd;
+	struct omst_reg *regtab = om_model_table(nd->model);
+	int regno = oms_nd_lookup_reg(nd, key);
+
+	if(regno < 0 || (regtab[regno].flags & reqflags) != reqflags || !regtab[regno].cvt_byte) {
+		oms_wjob_reject(job, key);
+		return -1;
+	}
+	job->want[regno] = 1;
+	job->value[regno] = regtab[regno].cvt_byte(valstr);
+	return regno;
+}
+
+OmsNode *
+oms_wjob_node(OmsWriteJob *job)
+{
+	return job->nd;
+}
+
+// the request couldn't be used; the job will just report badrequest
+void
+oms_wjob_set_bad(OmsWriteJob *job)
+{
+	job->badreq = 1;
+}
+
+// call fn(job, status, data) when the job finishes, after its result is published
+void
+oms_wjob_set_done(OmsWriteJob *job, void (*fn)(OmsWriteJob *job, const char *status, gpointer data), gpointer data)
+{
+	job->done = fn;
+	job->done_data = data;
+}
+
+static void
+oms_wjob_msg_done(OmsMessage *msg, int err)
+{
+	OmsWriteJob *job = (OmsWriteJob *)msg->done_data;
+
+	if(err == KE_TIMEOUT && msg->sdata[0] == OMMT_SETREG && job->retries < WJOB_RETRIES) {
+		// timeouts are usually line noise; try the same frame once more
+		job->retries++;
+		OmsMessage *rmsg = oms_node_send_msg_setregs(job->nd, &msg->sdata[1], msg->slength - 1);
+		rmsg->done = oms_wjob_msg_done;
+		rmsg->done_data = job;
+		return;
+	}
+	if(err != KE_NOERROR) {
+		if(job->phase >= WJ_ROLLBACK)
+			job->rb_errors++;
+		else if(job->phase == WJ_READ)
+			job->read_errors++;	// what it leaves unknown gets written regardless
+		else
+			job->errors++;
+	}
+	if(--job->pending == 0)
+		oms_wjob_advance(job);
+}
+
+// queue the fewest reads that cover the marked registers, counting them as pending
+static void
+oms_wjob_read(OmsWriteJob *job, guchar *mask)
+{
+	int starts[32], counts[32];
+	int n = oms_plan_reads(mask, 256, starts, counts, 32);
+	for(int i = 0; i < n; i++) {
+		OmsMessage *msg = oms_node_send_msg_readregs(job->nd, starts[i], counts[i]);
+		msg->done = oms_wjob_msg_done;
+		msg->done_data = job;
+		job->pending++;
+		job->nreads++;
+	}
+}
+
+// queue OMMT_SETREG frames for the registers marked in mask, one per contiguous run,
+// taking the values from vals[]
+static void
+oms_wjob_write(OmsWriteJob *job, guchar *mask, guchar *vals)
+{
+	guchar sbuf[16];
+	int start = -1;
+	for(int r = 0; r <= 256; r++) {
+		int w = (r < 256) && mask[r];
+		if(start >= 0 && (!w || r - start == 14)) {
+			sbuf[0] = start;
+			memcpy(&sbuf[1], &vals[start], r - start);
+			OmsMessage *msg = oms_node_send_msg_setregs(job->nd, sbuf, r - start + 1);
+			msg->done = oms_wjob_msg_done;
+			msg->done_data = job;
+			job->pending++;
+			job->nwrites++;
+			start = -1;
+		}
+		if(w && start < 0)
+			start = r;
+	}
+}
+
+static void
+oms_wjob_publish(OmsWriteJob *job, const char *status, GString *mismatch)
+{
+	GString *doc = g_string_sized_new(256);
+
+	g_string_append_printf(doc, "{\"status\":\"%s\",\"changed\":%d,\"writes\":%d,\"reads\":%d,\"errors\":%d",
+			       status, job->nchanged, job->nwrites, job->nreads,
+			       job->read_errors + job->errors + job->rb_errors);
+	g_string_append_printf(doc, ",\"mismatch\":[%s],\"rejected\":[%s]}",
+			       mismatch ? mismatch->str : "", job->rejected->str);
+	mqtt_publish_topic(&job->topic, doc->str, doc->len);
+	g_string_free(doc, TRUE);
+}
+
+// list registers marked in mask whose cached value isn't vals[], or wasn't read since write_time.
+// returns NULL if there are none.
+static GString *
+oms_wjob_mismatches(OmsWriteJob *job, guchar *vals)
+{
+	OmsNode *nd = job->nd;
+	GString *mismatch = NULL;
+	for(int r = 0; r < 256; r++) {
+		if(job->changed[r] && (nd->reg_cache[r].vtime < job->write_time
+				       || nd->reg_cache[r].val != vals[r])) {
+			if(!mismatch)
+				mismatch = g_string_new(NULL);
+			g_string_append_printf(mismatch, "%s%d", mismatch->len ? "," : "", r);
+		}
+	}
+	return mismatch;
+}
+
+static void
+oms_wjob_finish(OmsWriteJob *job, const char *status, GString *mismatch)
+{
+	oms_wjob_publish(job, status, mismatch);
+	if(mismatch)
+		g_string_free(mismatch, TRUE);
+	if(job->done)
+		job->done(job, status, job->done_data);
+	if(job->nd->wjob == job)
+		job->nd->wjob = NULL;
+	oms_wjob_free(job);
+}
+
+// move on to the next phase once everything queued in this one has finished
+static void
+oms_wjob_advance(OmsWriteJob *job)
+{
+	OmsNode *nd = job->nd;
+	GString *mismatch;
+
+	while(job->pending == 0) {
+		switch(job->phase) {
+		case WJ_READ:
+			if(job->txn) {  // can't promise a rollback without the old values
+				for(int r = 0; r < 256; r++) {
+					if(job->want[r] && !oms_nd_reg_fresh(nd, r)) {
+						oms_wjob_finish(job, "aborted", NULL);
+						return;
+					}
+				}
+			}
+			job->phase = WJ_WRITE;
+			job->write_time = time(NULL);
+			for(int r = 0; r < 256; r++) {
+				job->changed[r] = job->want[r]
+					&& (!nd->reg_cache[r].vtime || nd->reg_cache[r].val != job->value[r]);
+				job->prior[r] = nd->reg_cache[r].val;
+				job->nchanged += job->changed[r];
+			}
+			oms_wjob_write(job, job->changed, job->value);
+			break;
+		case WJ_WRITE:
+			job->phase = WJ_VERIFY;
+			oms_wjob_read(job, job->changed);
+			break;
+		case WJ_VERIFY:
+			mismatch = oms_wjob_mismatches(job, job->value);
+			if(!mismatch && !job->errors) {
+				oms_wjob_finish(job, job->nchanged ? (job->txn ? "commit" : "ok") : "unchanged", NULL);
+				return;
+			}
+			if(!job->txn) {
+				oms_wjob_finish(job, "failed", mismatch);
+				return;
+			}
+			if(mismatch)
+				g_string_free(mismatch, TRUE);
+			fprintf(stderr, "omnistat(%s) %s failed, rolling back\n", nd->name, job->cmd);
+			job->phase = WJ_ROLLBACK;
+			job->write_time = time(NULL);
+			oms_wjob_write(job, job->changed, job->prior);
+			break;
+		case WJ_ROLLBACK:
+			job->phase = WJ_RBVERIFY;
+			oms_wjob_read(job, job->changed);
+			break;
+		case WJ_RBVERIFY:
+			mismatch = oms_wjob_mismatches(job, job->prior);
+			oms_wjob_finish(job, (mismatch || job->rb_errors) ? "rollback-failed" : "rollback", mismatch);
+			return;
+		default:
+			return;
+		}
+	}
+}
+
+// start a job built with oms_wjob_new and oms_wjob_set_str.
+// only one job runs on a node at a time; a second one is refused.
+void
+oms_wjob_start(OmsWriteJob *job)
+{
+	OmsNode *nd = job->nd;
+	guchar mask[256];
+
+	if(job->txn && job->rejected->len)  // all or nothing
+		job->badreq = 1;
+	if(nd->wjob || job->badreq) {
+		oms_wjob_finish(job, job->badreq ? "badrequest" : "busy", NULL);
+		return;
+	}
+	nd->wjob = job;
+	oms_nd_boost(nd, 0);	// to see the thermostat respond
+
+	// can only diff against values we trust
+	job->phase = WJ_READ;
+	for(int r = 0; r < 256; r++)
+		mask[r] = job->want[r] && !oms_nd_reg_fresh(nd, r);
+	oms_wjob_read(job, mask);
+	oms_wjob_advance(job);
+}
+
+// abandon a node's running job, reporting it as cancelled.
+// its queued messages must already have been dropped.
+void
+oms_wjob_cancel(OmsNode *nd)
+{
+	if(nd->wjob)
+		oms_wjob_finish(nd->wjob, "cancelled", NULL);
+}
+
+static void
+oms_config_kv(char *key, char *val, void *data)
+{
+	oms_wjob_set_str((OmsWriteJob *)data, key, val, SV|WOK);
+}
+
+// apply a configuration document to a node: any of the registers flagged SV
+// (save/restore as group) in the model table, such as the weekly program and setup values.
+// only registers whose value differs from the cache are written.
+void
+oms_nd_set_config(OmsNode *nd, const char *payload, int len)
+{
+	OmsWriteJob *job = oms_wjob_new(nd, "config");
+	if(!om_model_table(nd->model) || kv_parse(payload, len, oms_config_kv, job) < 0)
+		job->badreq = 1;
+	oms_wjob_start(job);
+}
+
+static void
+oms_setmany_kv(char *key, char *val, void *data)
+{
+	oms_wjob_set_str((OmsWriteJob *)data, key, val, WOK);
+}
+
+// mqtt: omnistat/<node>/setmany, payload is register values as JSON or key=value,
+// any writable registers.  changed values go out in one OMMT_SETREG per contiguous run,
+// are read back, and one result is published on omnistat/<node>/result/setmany.
+void
+oms_nd_setmany(OmsNode *nd, const char *payload, int len)
+{
+	OmsWriteJob *job = oms_wjob_new(nd, "setmany");
+	if(!om_model_table(nd->model) || kv_parse(payload, len, oms_setmany_kv, job) < 0)
+		job->badreq = 1;
+	oms_wjob_start(job);
+}
+
+/*
+ * transactions: a group of register writes that is applied completely or not at all.
+ *	txn = oms_nd_txn_begin(nd, "txn");
+ *	oms_nd_txn_set(txn, "tstatmode", "heat");
+ *	oms_nd_txn_set(txn, "heat_set", "21.5");
+ *	oms_nd_txn_commit(txn);
+ * prior values come from reg_cache (read first if stale).  The outcome,
+ * commit, rollback, rollback-failed, aborted or unchanged, is published on
+ * omnistat/<node>/result/<cmd>, and passed to any oms_wjob_set_done callback.
+ */
+OmsWriteJob *
+oms_nd_txn_begin(OmsNode *nd, const char *cmd)
+{
+	OmsWriteJob *job = oms_wjob_new(nd, cmd);
+	job->txn = 1;
+	if(!om_model_table(nd->model))
+		job->badreq = 1;
+	return job;
+}
+
+int
+oms_nd_txn_set(OmsWriteJob *txn, char *regname, char *valstr)
+{
+	if(txn->badreq)
+		return -1;
+	return oms_wjob_set_str(txn, regname, valstr, WOK);
+}
+
+void
+oms_nd_txn_commit(OmsWriteJob *txn)
+{
+	oms_wjob_start(txn);
+}
+
+static void
+oms_txn_kv(char *key, char *val, void *data)
+{
+	oms_nd_txn_set((OmsWriteJob *)data, key, val);
+}
+
+// mqtt: omnistat/<node>/txn, payload is the register values as JSON or key=value
+void
+oms_nd_txn_str(OmsNode *nd, const char *payload, int len)
+{
+	OmsWriteJob *txn = oms_nd_txn_begin(nd, "txn");
+	if(kv_parse(payload, len, oms_txn_kv, txn) < 0)
+		txn->badreq = 1;
+	oms_nd_txn_commit(txn);
+}
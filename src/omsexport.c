@@ -0,0 +1,293 @@
+/*
+ * omsexport: read the history store written by mqomstat (see oms_store.c)
+ *
+ *   omsexport [-d store-dir] [-n node] [-r register] [-f from] [-t to] [-b]
+ *
+ * Writes the matching records of every segment in the directory, oldest first,
+ * as CSV lines "time_ms,node,register,value" (register in hex, value raw), or
+ * with -b as the 16-byte records themselves (layout in oms_store.h; node is
+ * then an index into that segment's name table).  from and to are unix times
+ * in seconds, inclusive; both default to the whole store.
+ *
+ * Segments are mapped, not read, and the start of the range is found by
+ * binary search on the record times, so a range costs what it contains.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <oms_store.h>
+
+#define OUTBUF_SIZE	(1 << 20)
+
+typedef struct {
+	char *path;
+	int64_t start_ms;
+	int64_t end_ms;		// time of its last record when we looked
+} Segment;
+
+static char outbuf[OUTBUF_SIZE];
+static size_t outlen;
+
+static void
+out_flush()
+{
+	if(outlen && fwrite(outbuf, 1, outlen, stdout) != outlen) {
+		perror("omsexport: write");
+		exit(1);
+	}
+	outlen = 0;
+}
+
+static void
+out_bytes(const void *p, size_t n)
+{
+	if(outlen + n > OUTBUF_SIZE)
+		out_flush();
+	if(n > OUTBUF_SIZE) {
+		fwrite(p, 1, n, stdout);
+		return;
+	}
+	memcpy(outbuf + outlen, p, n);
+	outlen += n;
+}
+
+// decimal, without printf; this is the inner loop
+static char *
+fmt_int(char *p, int64_t v)
+{
+	char tmp[24];
+	int n = 0;
+	uint64_t u = v < 0 ? -(uint64_t)v : (uint64_t)v;
+	if(v < 0)
+		*p++ = '-';
+	do {
+		tmp[n++] = '0' + u % 10;
+		u /= 10;
+	} while(u);
+	while(n)
+		*p++ = tmp[--n];
+	return p;
+}
+
+static void
+out_csv(const OmsStoreRec *r, const char *name, int namelen)
+{
+	static const char hex[] = "0123456789abcdef";
+	char *p;
+
+	// two numbers and the punctuation fit in 64, with the name
+	if(outlen + 64 + namelen > OUTBUF_SIZE)
+		out_flush();
+	p = outbuf + outlen;
+	p = fmt_int(p, r->t_ms);
+	*p++ = ',';
+	memcpy(p, name, namelen);
+	p += namelen;
+	*p++ = ',';
+	*p++ = '0';
+	*p++ = 'x';
+	*p++ = hex[r->reg >> 4];
+	*p++ = hex[r->reg & 15];
+	*p++ = ',';
+	p = fmt_int(p, r->val);
+	*p++ = '\n';
+	outlen = p - outbuf;
+}
+
+// first record with t_ms >= t, or with after, t_ms > t
+static uint64_t
+seek_time(const OmsStoreRec *recs, uint64_t n, int64_t t, int after)
+{
+	uint64_t lo = 0, hi = n;
+	while(lo < hi) {
+		uint64_t mid = lo + (hi - lo) / 2;
+		if(recs[mid].t_ms < t || (after && recs[mid].t_ms == t))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static int
+export_segment(const char *path, const char *node, int reg, int64_t from, int64_t to, int binary)
+{
+	int fd;
+	struct stat st;
+	void *map;
+	const OmsStoreHeader *hdr;
+	const OmsStoreRec *recs;
+	uint64_t n, i, end;
+	int node_id = -1;
+	int namelen[OMS_STORE_NAMES];
+
+	if((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "omsexport: %s: %s\n", path, strerror(errno));
+		if(fd >= 0)
+			close(fd);
+		return -1;
+	}
+	if(st.st_size < OMS_STORE_HDR) {
+		close(fd);
+		return 0;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) {
+		fprintf(stderr, "omsexport: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	hdr = map;
+	if(memcmp(hdr->magic, OMS_STORE_MAGIC, sizeof(hdr->magic)) || hdr->recsize != sizeof(OmsStoreRec)) {
+		fprintf(stderr, "omsexport: %s: not a store segment\n", path);
+		munmap(map, st.st_size);
+		return -1;
+	}
+	recs = (const OmsStoreRec *)((const char *)map + OMS_STORE_HDR);
+	// the daemon may still be writing; use only what's both counted and in the file
+	n = __atomic_load_n(&hdr->count, __ATOMIC_ACQUIRE);
+	if(n > (st.st_size - OMS_STORE_HDR) / sizeof(OmsStoreRec))
+		n = (st.st_size - OMS_STORE_HDR) / sizeof(OmsStoreRec);
+
+	for(int k = 0; k < hdr->nnames && k < OMS_STORE_NAMES; k++) {
+		namelen[k] = strnlen(hdr->names[k], OMS_STORE_NAMELEN);
+		if(node && strncmp(hdr->names[k], node, OMS_STORE_NAMELEN - 1) == 0)
+			node_id = k;
+	}
+	if(node && node_id < 0)
+		goto done;		// not in this segment
+
+	i = seek_time(recs, n, from, 0);
+	end = seek_time(recs, n, to, 1);
+	if(binary && !node && reg < 0) {
+		out_bytes(&recs[i], (end - i) * sizeof(OmsStoreRec));
+		goto done;
+	}
+	for(; i < end; i++) {
+		const OmsStoreRec *r = &recs[i];
+		if((node_id >= 0 && r->node != node_id) || (reg >= 0 && r->reg != reg) || r->node >= hdr->nnames)
+			continue;
+		if(binary)
+			out_bytes(r, sizeof(*r));
+		else
+			out_csv(r, hdr->names[r->node], namelen[r->node]);
+	}
+done:
+	munmap(map, st.st_size);
+	return 0;
+}
+
+static int
+segment_cmp(const void *a, const void *b)
+{
+	const Segment *sa = a, *sb = b;
+	return sa->start_ms < sb->start_ms ? -1 : sa->start_ms > sb->start_ms;
+}
+
+static void
+usage()
+{
+	fprintf(stderr, "usage: omsexport [-d store-dir] [-n node] [-r register] [-f from] [-t to] [-b]\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *dir = ".";
+	const char *node = NULL;
+	int reg = -1;
+	int64_t from = INT64_MIN, to = INT64_MAX;
+	int binary = 0;
+	int c;
+	DIR *d;
+	struct dirent *de;
+	Segment *segs = NULL;
+	int nsegs = 0, maxsegs = 0;
+	int rc = 0;
+
+	while((c = getopt(argc, argv, "d:n:r:f:t:b")) != -1) {
+		switch(c) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 'n':
+			node = optarg;
+			break;
+		case 'r':
+			reg = strtol(optarg, NULL, 0);
+			break;
+		case 'f':
+			from = strtoll(optarg, NULL, 0) * 1000;
+			break;
+		case 't':
+			to = strtoll(optarg, NULL, 0) * 1000 + 999;
+			break;
+		case 'b':
+			binary = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	if(optind != argc)
+		usage();
+
+	if(!(d = opendir(dir))) {
+		fprintf(stderr, "omsexport: %s: %s\n", dir, strerror(errno));
+		return 1;
+	}
+	while((de = readdir(d))) {
+		size_t len = strlen(de->d_name);
+		size_t slen = strlen(OMS_STORE_SUFFIX);
+		OmsStoreHeader hdr;
+		OmsStoreRec last;
+		Segment *sg;
+		int fd;
+		if(len <= slen || strcmp(de->d_name + len - slen, OMS_STORE_SUFFIX))
+			continue;
+		if(nsegs == maxsegs) {
+			maxsegs = maxsegs ? maxsegs * 2 : 64;
+			segs = realloc(segs, maxsegs * sizeof(Segment));
+		}
+		sg = &segs[nsegs];
+		sg->path = malloc(strlen(dir) + len + 2);
+		sprintf(sg->path, "%s/%s", dir, de->d_name);
+		// the times covered come from the segment itself, not its name: several
+		// daemons may share the directory, so segments overlap
+		if((fd = open(sg->path, O_RDONLY)) < 0) {
+			free(sg->path);
+			continue;
+		}
+		if(read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && memcmp(hdr.magic, OMS_STORE_MAGIC, sizeof(hdr.magic)) == 0
+		   && hdr.count > 0
+		   && pread(fd, &last, sizeof(last), OMS_STORE_HDR + (hdr.count - 1) * sizeof(OmsStoreRec)) == sizeof(last)) {
+			sg->start_ms = hdr.start_ms;
+			sg->end_ms = last.t_ms;
+			nsegs++;
+		} else
+			free(sg->path);
+		close(fd);
+	}
+	closedir(d);
+	qsort(segs, nsegs, sizeof(Segment), segment_cmp);
+
+	for(int i = 0; i < nsegs; i++) {
+		// records appended since the scan are newer than end_ms; close enough
+		if(segs[i].start_ms <= to && segs[i].end_ms >= from
+		   && export_segment(segs[i].path, node, reg, from, to, binary) < 0)
+			rc = 1;
+		free(segs[i].path);
+	}
+	free(segs);
+	out_flush();
+	return rc;
+}
@@ -1,4 +1,6 @@
 
+#include <string.h>
+#include <glib.h>
 #include <utils.h>
 
 // compute x - y for two timevals.  ought to be in a library.
@@ -26,3 +28,206 @@ timeval_subtract (struct timeval *result, struct timeval *x, struct timeval *y)
        return x->tv_sec < y->tv_sec;
 }
 
+
+// skip whitespace
+static char *
+kv_skipws(char *cp)
+{
+	while(*cp == ' ' || *cp == '\t' || *cp == '\r' || *cp == '\n')
+		cp++;
+	return cp;
+}
+
+// parse a JSON string starting at the opening quote, in place.
+// returns pointer past the closing quote, or NULL.
+static char *
+kv_json_string(char *cp, char **str)
+{
+	char *dp;
+	if(*cp != '"')
+		return NULL;
+	*str = dp = ++cp;
+	while(*cp && *cp != '"') {
+		if(*cp != '\\' || !cp[1]) {
+			*dp++ = *cp++;
+			continue;
+		}
+		cp++;
+		switch(*cp) {
+		case 'n': *dp++ = '\n'; break;
+		case 't': *dp++ = '\t'; break;
+		case 'r': *dp++ = '\r'; break;
+		case 'b': *dp++ = '\b'; break;
+		case 'f': *dp++ = '\f'; break;
+		case 'u':
+			if(g_ascii_isxdigit(cp[1]) && g_ascii_isxdigit(cp[2])
+			   && g_ascii_isxdigit(cp[3]) && g_ascii_isxdigit(cp[4])) {
+				gunichar c = g_ascii_xdigit_value(cp[1]) << 12 | g_ascii_xdigit_value(cp[2]) << 8
+					| g_ascii_xdigit_value(cp[3]) << 4 | g_ascii_xdigit_value(cp[4]);
+				if(c == 0 || (c >= 0xd800 && c < 0xe000))
+					c = '?';	// no NULs, and surrogate pairs aren't worth it here
+				// at most 3 bytes, so it fits where the 6-character escape was
+				dp += g_unichar_to_utf8(c, dp);
+				cp += 4;
+				break;
+			}
+			return NULL;
+		default:	// \" \\ \/
+			*dp++ = *cp;
+		}
+		cp++;
+	}
+	if(*cp != '"')
+		return NULL;
+	*dp = 0;
+	return cp+1;
+}
+
+// append str to s as a JSON string, quotes included.  for anything a client sent us
+// that is echoed back in a result.
+void
+json_append_str(GString *s, const char *str)
+{
+	g_string_append_c(s, '"');
+	for(const unsigned char *cp = (const unsigned char *)str; *cp; cp++) {
+		switch(*cp) {
+		case '"': g_string_append(s, "\\\""); break;
+		case '\\': g_string_append(s, "\\\\"); break;
+		case '\n': g_string_append(s, "\\n"); break;
+		case '\r': g_string_append(s, "\\r"); break;
+		case '\t': g_string_append(s, "\\t"); break;
+		default:
+			if(*cp < 0x20)
+				g_string_append_printf(s, "\\u%04x", *cp);
+			else
+				g_string_append_c(s, *cp);
+		}
+	}
+	g_string_append_c(s, '"');
+}
+
+/*
+ * split a command payload into key/value pairs.  accepts either a flat JSON object,
+ *	{"cool_set": 24.5, "weekday morn time": "06:30"}
+ * or key=value pairs separated by newlines, ';' or '&'.
+ * calls fn(key, value, data) for each pair.
+ * returns the number of pairs, or -1 on a syntax error (pairs before the error have been seen).
+ */
+int
+kv_parse(const char *payload, int len, void (*fn)(char *key, char *val, void *data), void *data)
+{
+	char *buf = g_strndup(payload, len);
+	char *cp = kv_skipws(buf);
+	char *key, *val;
+	int n = 0;
+
+	if(*cp == '{') {
+		cp = kv_skipws(cp+1);
+		while(*cp != '}') {
+			if(!(cp = kv_json_string(cp, &key)))
+				goto bad;
+			cp = kv_skipws(cp);
+			if(*cp++ != ':')
+				goto bad;
+			cp = kv_skipws(cp);
+			if(*cp == '"') {
+				if(!(cp = kv_json_string(cp, &val)))
+					goto bad;
+				fn(key, val, data);
+			} else {	// number or bare word
+				val = cp;
+				while(*cp && *cp != ',' && *cp != '}')
+					cp++;
+				if(!*cp)
+					goto bad;
+				char c = *cp;
+				*cp = 0;
+				fn(key, g_strchomp(val), data);
+				*cp = c;
+			}
+			n++;
+			cp = kv_skipws(cp);
+			if(*cp == ',')
+				cp = kv_skipws(cp+1);
+			else if(*cp != '}')
+				goto bad;
+		}
+	} else {
+		gchar **pairs = g_strsplit_set(cp, "\n;&", -1);
+		for(int i = 0; pairs[i]; i++) {
+			char *eq = strchr(pairs[i], '=');
+			if(!eq) {
+				if(*g_strstrip(pairs[i]) == 0)
+					continue;
+				g_strfreev(pairs);
+				goto bad;
+			}
+			*eq = 0;
+			fn(g_strstrip(pairs[i]), g_strstrip(eq+1), data);
+			n++;
+		}
+		g_strfreev(pairs);
+	}
+	g_free(buf);
+	return n;
+bad:
+	g_free(buf);
+	return -1;
+}
+
+/*
+ * split a list of names: a JSON array of strings, ["cool_set", "heat_set"],
+ * or names separated by commas, ';' or newlines.  A JSON object or key=value
+ * pairs are accepted too, and only the keys used.
+ * calls fn(name, data) for each.  returns the number of names, or -1 on a syntax error.
+ */
+struct name_list_kv {
+	void (*fn)(char *name, void *data);
+	void *data;
+};
+
+static void
+name_list_kv(char *key, char *val, void *data)
+{
+	struct name_list_kv *nl = data;
+	nl->fn(key, nl->data);
+}
+
+int
+name_list_parse(const char *payload, int len, void (*fn)(char *name, void *data), void *data)
+{
+	char *buf = g_strndup(payload, len);
+	char *cp = kv_skipws(buf);
+	int n = 0;
+
+	if(*cp == '{' || strchr(cp, '=')) {
+		struct name_list_kv nl = { fn, data };
+		g_free(buf);
+		return kv_parse(payload, len, name_list_kv, &nl);
+	}
+	if(*cp == '[') {
+		cp++;
+		char *ep = strrchr(cp, ']');
+		if(!ep) {
+			g_free(buf);
+			return -1;
+		}
+		*ep = 0;
+	}
+	gchar **names = g_strsplit_set(cp, ",;\n", -1);
+	for(int i = 0; names[i]; i++) {
+		char *name = g_strstrip(names[i]);
+		int l = strlen(name);
+		if(l >= 2 && name[0] == '"' && name[l-1] == '"') {
+			name[l-1] = 0;
+			name++;
+		}
+		if(*name) {
+			fn(name, data);
+			n++;
+		}
+	}
+	g_strfreev(names);
+	g_free(buf);
+	return n;
+}
@@ -4,8 +4,12 @@
 
 #include <sys/time.h>
 #include <sys/types.h>
+#include <glib.h>
 
 extern int timeval_subtract (struct timeval *result, struct timeval *x, struct timeval *y);
+extern int kv_parse(const char *payload, int len, void (*fn)(char *key, char *val, void *data), void *data);
+extern void json_append_str(GString *s, const char *str);
+extern int name_list_parse(const char *payload, int len, void (*fn)(char *name, void *data), void *data);
 
 #endif
 